@@ -2,6 +2,7 @@
 #define _DOUBLY_LINKED_LIST
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef enum mode {
 	VALUE,
@@ -16,6 +17,23 @@ typedef struct _dll_internal dll_t;
 
 typedef struct _dll_iterator dlli_t;
 
+/**
+ * @brief priority queue (pairing heap) of list nodes (see dllh_new)
+ */
+typedef struct _dll_heap dllh_t;
+
+/**
+ * @brief memory held by a list in bytes (see dll_memory_usage)
+ * overhead includes the list header, estimated malloc headers/padding,
+ * the epochs of the nodes and unused slots of compacted storage
+ */
+typedef struct dll_memory_usage {
+    size_t payload; // user data (REFERENCE: the stored pointers)
+    size_t links; // prev/next pointers including the end node
+    size_t overhead; // everything else
+    size_t total; // sum of all above
+} dll_memory_usage_t;
+
 /**
  * @brief function pointer for deleting user data
  * user can use create a function to free or remove own data
@@ -32,6 +50,17 @@ typedef void (*foreach_fun)(int index, void *data, void *usr);
 
 typedef int (*cmp)(void *dl, void *dr);
 
+/**
+ * @brief function pointer for hashing user data (see dll_new_indexed)
+ * equal data needs the same hash
+ */
+typedef size_t (*hash_fun)(void *data);
+
+/**
+ * @brief function pointer that checks user data for equality
+ */
+typedef bool (*equal_fun)(void *dl, void *dr);
+
 /**
  * @brief creates new doubly-linked-list (dll)
  * 
@@ -41,6 +70,34 @@ typedef int (*cmp)(void *dl, void *dr);
  */
 dll_t *dll_new(op_mode mode, size_t data_size);
 
+/**
+ * @brief creates new list with a hash index of its data
+ * dll_find, dll_contains and dll_remove_value take O(1) on average
+ * data inside the list must not be changed in a way that changes its hash
+ *
+ * @param mode see dll_new
+ * @param data_size see dll_new
+ * @param hash hashes user data (VALUE: pointer to data; REFERENCE: the reference)
+ * @param equal compares user data like hash gets it
+ * @return dll_t* pointer to a list
+ */
+dll_t *dll_new_indexed(op_mode mode, size_t data_size, hash_fun hash, equal_fun equal);
+
+/**
+ * @brief creates new list that stores its data in one growable ring buffer
+ * instead of linked nodes; same dll_* functions
+ * dll_peek is O(1), pushing/popping at both ends is amortized O(1) without
+ * allocation and dll_foreach scans memory linearly
+ * dll_insert/dll_remove in the middle move the elements of the shorter side;
+ * dll_splice/dll_split copy the elements
+ * pointers returned by dll_peek etc. get invalid after the next change
+ *
+ * @param mode see dll_new
+ * @param data_size see dll_new
+ * @return dll_t* pointer to a list
+ */
+dll_t *dll_new_ring(op_mode mode, size_t data_size);
+
 /**
  * @brief takes data from an array and creates a list
  * if array consists of pointers: the pointers will be referenced/copied
@@ -144,12 +201,21 @@ void *dll_pop_front(dll_t *list, void *dest);
 void *dll_peek(dll_t *list, int pos);
 
 /**
- * @brief reverses a list
+ * @brief reverses a list in O(1)
+ * only the orientation of the list changes; the nodes stay untouched
  * 
  * @param list 
  */
 void dll_reverse(dll_t *list);
 
+/**
+ * @brief relinks the nodes so that their physical order matches the order
+ * of the list again (after dll_reverse); dll_sort does this on its own
+ *
+ * @param list
+ */
+void dll_materialize(dll_t *list);
+
 /**
  * @brief deletes all data inside list
  * 
@@ -173,4 +239,245 @@ void *dlli_prev(dlli_t *iter);
 
 void dll_sort(dll_t *list, cmp c);
 
+/**
+ * @brief moves the nodes [from, to) of src in front of position pos of dst
+ * the nodes are relinked; blocks of dll_compact/dll_reserve holding only
+ * moved nodes go along to dst; a moved node that shares its block with
+ * nodes staying in src gets copied into its own allocation
+ * O(1) besides the walks to pos, from and to; the moved nodes are only
+ * visited one by one if a list has an index or blocks, or if only one of
+ * the lists is reversed
+ * both lists need the same mode and data_size
+ *
+ * @param dst destination list
+ * @param pos insert position in dst (can be negative; see dll_insert)
+ * @param src source list (must not be dst)
+ * @param from first index in src
+ * @param to index after the last moved node in src
+ */
+void dll_splice(dll_t *dst, int pos, dll_t *src, int from, int to);
+
+/**
+ * @brief splits list at pos; nodes [pos, size) are moved to a new list
+ * relinks the nodes like dll_splice (O(1) besides the walk to pos for a
+ * list without index or blocks)
+ *
+ * @param list
+ * @param pos first index of the new list (may be negative)
+ * @return dll_t* new list holding the tail
+ */
+dll_t *dll_split(dll_t *list, int pos);
+
+/**
+ * @brief moves the elements of src from the current element of first to
+ * the current element of last (both included) in front of the current
+ * element of at (dst); appends them if at is not on an element
+ * like dll_splice, but the positions are given by iterators, so neither
+ * list is walked to find them: O(number of moved elements), which are
+ * counted to keep the sizes right (not O(1))
+ * first and last stay on their elements, which now belong to dst
+ * ring lists are not supported (see dll_splice); while snapshots of src
+ * or dst exist, the lists are copied first (see dll_snapshot)
+ *
+ * @param at iterator of dst (must not be src)
+ * @param first iterator of src on the first moved element
+ * @param last iterator of src on the last moved element (not before first)
+ */
+void dlli_splice(dlli_t *at, dlli_t *first, dlli_t *last);
+
+/**
+ * @brief reports how much memory the list holds
+ * malloc overhead is an estimate (one size_t header, 2*size_t granularity)
+ * every node carries two epochs (8 bytes, see dll_snapshot) next to its
+ * links, counted as overhead: a node with an int takes 48 bytes on its own
+ * (malloc) and 32 bytes in a block of dll_compact/dll_reserve
+ *
+ * @param list
+ * @return dll_memory_usage_t bytes by category
+ */
+dll_memory_usage_t dll_memory_usage(dll_t *list);
+
+/**
+ * @brief moves all nodes into contiguous blocks of 4 KiB (in list order)
+ * frees the old nodes and blocks; data pointers returned before get invalid
+ * slots of removed nodes get reused; a block is freed when it gets empty,
+ * so a list that shrinks after dll_compact gives its memory back
+ *
+ * @param list
+ */
+void dll_compact(dll_t *list);
+
+/**
+ * @brief reserves slots for count more nodes in blocks of 4 KiB
+ * following inserts (e.g. dll_push_back) use the slots in address order,
+ * so neighbouring nodes are neighbours in memory (fast traversal)
+ * the blocks are kept until dll_compact or dll_delete, even if they get empty
+ *
+ * @param list
+ * @param count number of slots
+ * @return false if memory could not be allocated
+ */
+bool dll_reserve(dll_t *list, int count);
+
+/**
+ * @brief creates a snapshot of the list in O(1)
+ * the snapshot shares the nodes with list and never sees later changes of
+ * list: nodes carry the epoch of their insert and removal, and a node
+ * list removes stays (skipped by list) until no snapshot sees it anymore
+ * inserting and removing single nodes (dll_insert, dll_remove, push, pop,
+ * dll_remove_value, dll_clear) do not copy; functions that relink many
+ * nodes (dll_sort, dll_materialize, dll_splice, dll_split, dll_compact,
+ * dll_kway_merge, dllh_push_list, dllh_drain) copy the nodes of list
+ * first while snapshots of it exist; ring lists copy their buffer on the
+ * first change after a snapshot
+ * dll_snapshot(list) must be called on the thread that changes list; a
+ * snapshot of a snapshot can be taken on any thread using that snapshot
+ * readers can use dll_peek, dll_iter, dll_foreach etc. on a snapshot
+ * without locks while another thread changes list; use one snapshot per
+ * thread (dll_peek caches the position inside the dll_t)
+ * list and its snapshots share the data: data must not be changed in
+ * place (through dll_peek, dll_foreach etc. of list or a snapshot) while
+ * snapshots exist
+ * changing a snapshot turns it into a list of its own (copy)
+ * free the snapshot with dll_delete; the delete function passed to
+ * dll_delete(list) is called on the data list did not remove once the last
+ * snapshot is gone (on the thread deleting that snapshot); the one passed
+ * for a snapshot is not used (all lists sharing a ring buffer are alike:
+ * the delete function of any of them is used)
+ *
+ * @param list
+ * @return dll_t* snapshot (a normal list)
+ */
+dll_t *dll_snapshot(dll_t *list);
+
+/**
+ * @brief finds data equal to data
+ * without index (see dll_new_indexed): O(n); compares bytes (VALUE) or
+ * pointers (REFERENCE)
+ *
+ * @param list
+ * @param data data to look for (like the data passed to dll_insert)
+ * @return reference to user data in list or NULL
+ */
+void *dll_find(dll_t *list, void *data);
+
+/**
+ * @brief checks if list holds data equal to data (see dll_find)
+ *
+ * @param list
+ * @param data data to look for
+ * @return true if found
+ */
+bool dll_contains(dll_t *list, void *data);
+
+/**
+ * @brief removes one element equal to data (see dll_find)
+ * mode=VALUE copies the data to dest; mode=REFERENCE stores the reference
+ * in *(void **)dest; dest may be NULL
+ *
+ * @param list
+ * @param data data to look for
+ * @param dest see description
+ * @return true if an element was removed
+ */
+bool dll_remove_value(dll_t *list, void *data, void *dest);
+
+/**
+ * @brief creates new priority queue; the element that dll_sort would put
+ * first comes out first (reverse c for the other end)
+ * the elements are stored in list nodes; order of equal elements is not
+ * specified
+ *
+ * @param mode see dll_new
+ * @param data_size see dll_new
+ * @param c compare function (see dll_sort)
+ * @return dllh_t* pointer to a priority queue
+ */
+dllh_t *dllh_new(op_mode mode, size_t data_size, cmp c);
+
+/**
+ * @brief deletes priority queue and optionally all user data
+ *
+ * @param heap
+ * @param func see dll_delete
+ */
+void dllh_delete(dllh_t *heap, delete_data_fun func);
+
+/**
+ * @brief inserts data in O(1)
+ *
+ * @param heap
+ * @param data data to insert (see dll_insert)
+ */
+void dllh_push(dllh_t *heap, void *data);
+
+/**
+ * @brief first element in O(1)
+ *
+ * @param heap
+ * @return reference to user data or NULL if heap is empty
+ */
+void *dllh_peek(dllh_t *heap);
+
+/**
+ * @brief removes the first element in O(log(n)) amortized
+ *
+ * @param heap
+ * @param dest see dll_remove
+ * @return see dll_remove
+ */
+void *dllh_pop(dllh_t *heap, void *dest);
+
+/**
+ * @brief number of elements
+ *
+ * @param heap
+ * @return int number of elements; -1 if heap is null (like dll_size)
+ */
+int dllh_size(dllh_t *heap);
+
+/**
+ * @brief moves all elements of list into heap in O(n)
+ * the nodes are relinked, nothing gets copied (ring lists: copied);
+ * list is empty afterwards
+ * heap and list need the same mode and data_size
+ *
+ * @param heap
+ * @param list
+ */
+void dllh_push_list(dllh_t *heap, dll_t *list);
+
+/**
+ * @brief moves all elements of heap in order to the end of list
+ * in O(n*log(n)); relinks the nodes like dllh_push_list
+ *
+ * @param heap
+ * @param list
+ */
+void dllh_drain(dllh_t *heap, dll_t *list);
+
+/**
+ * @brief merges k sorted lists into lists[0] in O(n*log(k)); the other
+ * lists are empty afterwards
+ * the nodes are relinked, nothing gets copied; stable: of equal elements
+ * those of earlier lists come first
+ * with a ring list the lists are appended and sorted (O(n*log(n)))
+ *
+ * @param lists k different lists with the same mode and data_size
+ * @param k number of lists
+ * @param c compare function the lists are sorted by (see dll_sort)
+ */
+void dll_kway_merge(dll_t **lists, int k, cmp c);
+
+/**
+ * @brief checks the internal invariants of list (for tests)
+ * links in both directions, size, cached position, slab counters, index
+ * and ring bounds; prints an error message for the first broken one
+ * O(n) plus the number of slots in blocks
+ *
+ * @param list
+ * @return true if list is consistent
+ */
+bool dll_validate(dll_t *list);
+
 #endif//_DOUBLY_LINKED_LIST
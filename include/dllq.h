@@ -0,0 +1,122 @@
+#ifndef _DOUBLY_LINKED_LIST_QUEUE
+#define _DOUBLY_LINKED_LIST_QUEUE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "dll.h"
+
+/**
+ * @brief dllq_t is a bounded, thread safe FIFO queue built on a dll_t
+ * forward declaration of dllq_t; you can only use dllq_t POINTERS
+ */
+typedef struct _dll_queue dllq_t;
+
+/**
+ * @brief creates a new queue
+ * all nodes are reserved up front (see dll_reserve); pushing and popping
+ * does not allocate memory
+ *
+ * @param mode value: copies data; reference: stores the reference pointer
+ * @param data_size value: size of the data; reference: don't care
+ * @param capacity maximum number of elements
+ * @return dllq_t* pointer to a queue
+ */
+dllq_t *dllq_new(op_mode mode, size_t data_size, int capacity);
+
+/**
+ * @brief deletes the queue and optionally all user data
+ * no thread may use the queue anymore
+ *
+ * @param queue
+ * @param func see dll_delete
+ */
+void dllq_delete(dllq_t *queue, delete_data_fun func);
+
+/**
+ * @brief closes the queue; blocked threads wake up
+ * pushing fails afterwards, popping works until the queue is empty
+ *
+ * @param queue
+ */
+void dllq_close(dllq_t *queue);
+
+/**
+ * @brief appends data; blocks while the queue is full
+ *
+ * @param queue
+ * @param data data to insert
+ * @return false if the queue is closed
+ */
+bool dllq_push(dllq_t *queue, void *data);
+
+/**
+ * @brief appends data if the queue is not full (never blocks)
+ *
+ * @param queue
+ * @param data data to insert
+ * @return false if the queue is full or closed
+ */
+bool dllq_try_push(dllq_t *queue, void *data);
+
+/**
+ * @brief appends data; blocks at most timeout_ms while the queue is full
+ *
+ * @param queue
+ * @param data data to insert
+ * @param timeout_ms maximum time to wait in milliseconds
+ * @return false on timeout or if the queue is closed
+ */
+bool dllq_timed_push(dllq_t *queue, void *data, long timeout_ms);
+
+/**
+ * @brief removes the first element; blocks while the queue is empty
+ * mode=VALUE copies data to dest; mode=REFERENCE stores the pointer in
+ * *(void **)dest; dest may be NULL
+ *
+ * @param queue
+ * @param dest see description
+ * @return false if the queue is closed and empty
+ */
+bool dllq_pop(dllq_t *queue, void *dest);
+
+/**
+ * @brief removes the first element if there is one (never blocks)
+ *
+ * @param queue
+ * @param dest see dllq_pop
+ * @return false if the queue is empty
+ */
+bool dllq_try_pop(dllq_t *queue, void *dest);
+
+/**
+ * @brief removes the first element; blocks at most timeout_ms
+ *
+ * @param queue
+ * @param dest see dllq_pop
+ * @param timeout_ms maximum time to wait in milliseconds
+ * @return false on timeout or if the queue is closed and empty
+ */
+bool dllq_timed_pop(dllq_t *queue, void *dest, long timeout_ms);
+
+/**
+ * @brief removes up to max elements with one wakeup; blocks while empty
+ * dest is an array of max elements (VALUE: data_size bytes each;
+ * REFERENCE: void pointers)
+ *
+ * @param queue
+ * @param dest array for the elements
+ * @param max maximum number of elements (at least 1)
+ * @return int number of elements; 0 if the queue is closed and empty;
+ * -1 if queue or dest is null or max is smaller than 1
+ */
+int dllq_pop_batch(dllq_t *queue, void *dest, int max);
+
+/**
+ * @brief gets the number of elements in the queue
+ *
+ * @param queue
+ * @return int number of elements
+ */
+int dllq_size(dllq_t *queue);
+
+#endif//_DOUBLY_LINKED_LIST_QUEUE
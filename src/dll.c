@@ -1,32 +1,236 @@
+#define _POSIX_C_SOURCE 200112L // posix_memalign
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <memory.h>
 #include <stdint.h>
+#include <sys/types.h>
 #include "dll.h"
 
+// alignment of node slots inside a slab
+#define DLL_ALIGN 16
+
+// bytes of a slab (see dll_compact); a slab holds at least one node
+// slabs are aligned to their size, so a node finds its slab by its address
+#define DLL_SLAB_SIZE 4096
+
 typedef struct _dll_node_internal dll_node_t;
 
+typedef struct _dll_slab dll_slab_t;
+
+typedef struct _dll_share dll_share_t;
+
+typedef struct _dll_epoch dll_epoch_t;
+
+typedef struct _dll_index dll_index_t;
+
+// initial number of entries of an index (power of two)
+#define DLL_INDEX_MIN 16
+
+// initial number of slots of a ring list (power of two)
+#define DLL_RING_MIN 8
+
+// initial number of entries of the removed nodes of a list with snapshots
+#define DLL_REMOVED_MIN 16
+
+// last epoch of a list (below 2^31, see born); the epochs start over after
+// it (see _dll_write)
+#ifndef DLL_EPOCH_MAX
+#define DLL_EPOCH_MAX 0x7ffffff0u
+#endif
+#if DLL_EPOCH_MAX > 0x7fffffffu
+#error "DLL_EPOCH_MAX needs to be below 2^31"
+#endif
+
+// nodes shared with snapshots are read by other threads (see dll_snapshot)
+#ifdef __GNUC__
+#define DLL_ATOMIC_ADD(ptr, val) __atomic_add_fetch((ptr), (val), __ATOMIC_ACQ_REL)
+#define DLL_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define DLL_ATOMIC_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else // not thread safe
+#define DLL_ATOMIC_ADD(ptr, val) (*(ptr) += (val))
+#define DLL_ATOMIC_LOAD(ptr) (*(ptr))
+#define DLL_ATOMIC_STORE(ptr, val) (*(ptr) = (val))
+#endif
+
 struct _dll_node_internal {
     dll_node_t *prev; // points to previous node
     dll_node_t *next; // points to next node
+    unsigned int born : 31; // epoch of the insert (see dll_snapshot)
+    unsigned int in_slab : 1; // 0: allocated on its own (see _dll_node_slab)
+    uint32_t died; // epoch of the removal; 0: node is in the list
 
     unsigned char data[]; // contains data
 };
 
+/**
+ * @brief block of DLL_SLAB_SIZE bytes of node slots; created by dll_compact
+ * and dll_reserve; freed as soon as no slot is used anymore (unless reserved)
+ * the slabs of a list form a ring; slabs with free slots come first
+ */
+struct _dll_slab {
+    dll_slab_t *prev; // neighbours in the ring of slabs of the list
+    dll_slab_t *next;
+    dll_node_t *free_slots; // unused slots (linked by next)
+    int capacity; // number of slots
+    int used; // slots holding a node
+    int moving; // nodes of the range dll_splice moves (0 otherwise)
+    bool reserved; // kept when empty (see dll_reserve)
+};
+
+/**
+ * @brief snapshots that see the same epoch of a list (see dll_snapshot)
+ */
+struct _dll_epoch {
+    dll_epoch_t *next; // record of a later epoch
+    uint32_t epoch;
+    int snapshots; // snapshots using the record (0: record can go)
+};
+
+/**
+ * @brief nodes used by a list and its snapshots (see dll_snapshot)
+ * the list (the writer) never changes a node a snapshot sees: it marks
+ * removed nodes with its epoch and leaves them linked until no snapshot
+ * sees them anymore; unlinked nodes are freed once every snapshot older
+ * than the unlink is gone (a reader may still stand on them until then)
+ * ring lists copy their buffer on the first change instead
+ */
+struct _dll_share {
+    int refs; // number of lists (writer and snapshots)
+    dll_epoch_t *oldest; // epochs of the snapshots (oldest first)
+    dll_epoch_t *newest;
+    struct {
+        dll_node_t *node;
+        uint32_t epoch; // removal (still linked) or unlink epoch
+    } *removed; // removed nodes in the order of removal
+    int removed_head; // first node not freed yet
+    int removed_linked; // first node still linked
+    int removed_count;
+    int removed_capacity;
+    dll_node_t *end; // nodes and slabs the writer left (see _dll_leave)
+    dll_slab_t *slabs;
+    delete_data_fun func; // delete function of the writer (see _dll_leave)
+};
+
+/**
+ * @brief hash table (open addressing) of the nodes (see dll_new_indexed)
+ * has at least twice as many entries as nodes
+ */
+struct _dll_index {
+    size_t capacity; // number of entries (power of two)
+    size_t count; // number of nodes
+    struct {
+        dll_node_t *node; // NULL: entry is free
+        size_t hash; // hash of the node data
+    } entries[];
+};
+
 struct _dll_internal {
     ssize_t size; // number of elements
 
     dll_node_t *end; // points to initial element
     size_t data_size; // stores size of data in bytes
     op_mode op_mode;
+
+    dll_node_t *finger; // last accessed node (or NULL)
+    int finger_pos; // index of finger
+
+    dll_slab_t *slabs; // ring of pooled node storage (see dll_compact)
+
+    dll_share_t *share; // NULL if nodes are not shared with a snapshot
+    dll_epoch_t *snapshot; // NULL unless list is a snapshot of a linked list
+    uint32_t epoch; // epoch of the changes (a snapshot: epoch it sees)
+    bool epoch_seen; // a snapshot sees epoch; the next change starts a new one
+    dll_node_t *live_first; // first and last node the writer sees (physical
+    dll_node_t *live_last; // order) while it shares nodes; NULL: not known
+
+    bool reversed; // true: logical order follows prev (see dll_reverse)
+
+    hash_fun hash; // NULL if list has no index
+    equal_fun equal;
+    dll_index_t *index; // index of the writer (snapshots have none)
+
+    unsigned char *ring; // NULL: linked nodes; else elements (see dll_new_ring)
+    int ring_capacity; // number of slots (power of two)
+    int ring_head; // slot of the first element
 };
 
 struct _dll_iterator {
     dll_t *list;
     dll_node_t *curr;
+    int pos; // index of the current element of a ring list (-1: end)
 };
 
+// logical next/previous node; takes the orientation of the list into account
+#define DLL_NEXT(list, node) ((list)->reversed ? (node)->prev : (node)->next)
+#define DLL_PREV(list, node) ((list)->reversed ? (node)->next : (node)->prev)
+
+/**
+ * @brief internal function; sets the logical next node of node
+ * with snapshots, the store publishes node to readers on other threads
+ */
+static void _dll_set_next(dll_t *list, dll_node_t *node, dll_node_t *next) {
+    dll_node_t **link = list->reversed ? &node->prev : &node->next;
+    if (list->share) DLL_ATOMIC_STORE(link, next);
+    else *link = next;
+}
+
+/**
+ * @brief internal function; sets the logical previous node of node
+ */
+static void _dll_set_prev(dll_t *list, dll_node_t *node, dll_node_t *prev) {
+    dll_node_t **link = list->reversed ? &node->next : &node->prev;
+    if (list->share) DLL_ATOMIC_STORE(link, prev);
+    else *link = prev;
+}
+
+/**
+ * @brief internal function; checks if list sees node (see dll_snapshot)
+ * a list sees the nodes it did not remove; a snapshot sees the nodes
+ * inserted up to its epoch and not removed until then
+ */
+static bool _dll_sees(dll_t *list, dll_node_t *node) {
+    uint32_t died = DLL_ATOMIC_LOAD(&node->died);
+    if (!list->snapshot) return died == 0;
+    return node->born <= list->epoch && (died == 0 || died > list->epoch);
+}
+
+/**
+ * @brief internal function; next node in direction forward (physical
+ * orientation) that list sees, or the end node
+ */
+static dll_node_t *_dll_step_shared(dll_t *list, dll_node_t *node, bool forward) {
+    dll_node_t **live = NULL;
+    if (node == list->end && !list->snapshot) {
+        // removed nodes pile up at the ends (e.g. of a queue); the writer
+        // remembers its first and last node (see _dll_insert_at, _dll_retire)
+        live = forward ? &list->live_first : &list->live_last;
+        if (*live) return *live;
+    }
+    do {
+        node = DLL_ATOMIC_LOAD(forward ? &node->next : &node->prev);
+    } while (node != list->end && !_dll_sees(list, node));
+    if (live) *live = node;
+    return node;
+}
+
+/**
+ * @brief internal function; logical next node list sees (or the end node)
+ * removed nodes stay linked while snapshots exist; they are skipped
+ */
+static dll_node_t *_dll_next(dll_t *list, dll_node_t *node) {
+    if (!list->share) return DLL_NEXT(list, node);
+    return _dll_step_shared(list, node, !list->reversed);
+}
+
+/**
+ * @brief internal function; logical previous node list sees (or the end node)
+ */
+static dll_node_t *_dll_prev(dll_t *list, dll_node_t *node) {
+    if (!list->share) return DLL_PREV(list, node);
+    return _dll_step_shared(list, node, list->reversed);
+}
+
 /**
  * @brief prints an error and details; useful to print error messages
  *
@@ -56,8 +260,25 @@ dll_t *dll_new(op_mode mode, size_t data_size) {
     }
     list->end->next = list->end;
     list->end->prev = list->end;
+    list->end->in_slab = 0;
 
     list->size = 0;
+    list->finger = NULL;
+    list->finger_pos = 0;
+    list->slabs = NULL;
+    list->share = NULL;
+    list->snapshot = NULL;
+    list->epoch = 1;
+    list->epoch_seen = false;
+    list->live_first = NULL;
+    list->live_last = NULL;
+    list->reversed = false;
+    list->hash = NULL;
+    list->equal = NULL;
+    list->index = NULL;
+    list->ring = NULL;
+    list->ring_capacity = 0;
+    list->ring_head = 0;
     list->op_mode = mode;
     if (mode == REFERENCE) {
         list->data_size = sizeof(void *);
@@ -79,558 +300,2565 @@ dll_t *dll_from_value_array(void *array, int len, op_mode mode, size_t elem_size
 }
 
 /**
- * @brief internal function; allocates new node and copying data
- * 
- * @param data_size size of the data in bytes
- * @param data data to insert (copy)
- * @return (dll_node_t *) node pointer
+ * @brief internal function; size of one node slot inside a slab
+ * rounded up so every slot is aligned like a malloc result
  */
-static dll_node_t *_dll_new_node(op_mode mode, size_t data_size, void *data) {
-    dll_node_t *node = malloc(sizeof(*node) + data_size);
-    if (!node) {
-        error("_dll_new_node", "Could not allocate memory");
-        return NULL;
-    }
-    node->prev = NULL;
-    node->next = NULL;
-    if (mode == REFERENCE) {
-        //memcpy(node->data, &data, data_size);
-        *(void **)node->data = data;
-        //*(void **)node->data = data;
-    } else { // VALUE
-        memcpy(node->data, data, data_size);
-    }
-    
-    return node;
+static size_t _dll_slot_size(size_t data_size) {
+    size_t size = sizeof(dll_node_t) + data_size;
+    return (size + DLL_ALIGN - 1) / DLL_ALIGN * DLL_ALIGN;
 }
 
 /**
- * @brief deletes a node and optionally its data
- * 
- * @param node node to delete
- * @param func user data delete function
+ * @brief internal function; first node slot of a slab
  */
-static void _dll_delete_node(op_mode m, dll_node_t *node, delete_data_fun func) {
-    if (!node) {
-        error("_dll_delete_node", "node is null");
-        return;
-    }
-    printf("fn ");
-    if (func) {
-        if (m == REFERENCE) {
-            (*func)(*(void **)node->data);
-        } else { // VALUE
-            (*func)(node->data);
-        }
-    }
-    free(node);
+static unsigned char *_dll_slab_slots(dll_slab_t *slab) {
+    size_t header = (sizeof(*slab) + DLL_ALIGN - 1) / DLL_ALIGN * DLL_ALIGN;
+    return (unsigned char *)slab + header;
 }
 
 /**
- * @brief gets called when a node gets removed from the list and returns data
- * 
- * @param m 
- * @param node 
- * @return void* 
+ * @brief internal function; slab holding node or NULL
  */
-static void *_dll_remove_node(dll_t *list, dll_node_t *node, void *dest) {
-    if (!list || !node) {
-        error("_dll_remove_node", "node is null");
-        return NULL;
-    }
-    op_mode m = list->op_mode;
-    if (m == REFERENCE) {
-        void *ref = *(void **)node->data;
-        _dll_delete_node(m, node, NULL); // TODO remove != delete fun
-        return ref;
-    } else {
-        if (dest) {
-            memcpy(dest, node->data, list->data_size);
-        }
-        _dll_delete_node(m, node, NULL); // TODO remove != delete fun
-        return dest;
-    }
+static dll_slab_t *_dll_node_slab(dll_node_t *node) {
+    if (!node->in_slab) return NULL;
+    return (dll_slab_t *)((uintptr_t)node & ~(uintptr_t)(DLL_SLAB_SIZE - 1));
 }
 
-// see dll.h
-void dll_delete(dll_t *list, delete_data_fun func) {
-    if (!list) return;
-    dll_node_t *end = list->end;
-    dll_node_t *curr = end->next;
-    dll_node_t *tmp;
-    while (curr != end) {
-        tmp = curr;
-        curr = curr->next;
-        _dll_delete_node(list->op_mode, tmp, func);
-    }
-    free(end);
-    free(list);
+/**
+ * @brief internal function; number of node slots of a slab
+ * all slots start in the first DLL_SLAB_SIZE bytes (see _dll_node_slab)
+ */
+static int _dll_slab_capacity(size_t data_size) {
+    size_t header = (sizeof(dll_slab_t) + DLL_ALIGN - 1) / DLL_ALIGN * DLL_ALIGN;
+    size_t slot_size = _dll_slot_size(data_size);
+    if (header + slot_size >= DLL_SLAB_SIZE) return 1;
+    return (DLL_SLAB_SIZE - header) / slot_size;
 }
 
-// see dll.h
 /**
- * @todo refactor
+ * @brief internal function; adds slab to the ring of slabs of list
+ * in front if it has free slots, at the back otherwise
  */
-void dll_display(dll_t *list, display_data_fun func) {
-    if (!list) {
-        printf("null\n");
+static void _dll_link_slab(dll_t *list, dll_slab_t *slab) {
+    dll_slab_t *first = list->slabs;
+    if (!first) {
+        slab->prev = slab;
+        slab->next = slab;
+        list->slabs = slab;
         return;
     }
-    dll_node_t *end = list->end;
-    dll_node_t *curr = end->next;
-    op_mode mode = list->op_mode;
-    if (curr == end) {
-        printf("empty1\n");
+    slab->prev = first->prev;
+    slab->next = first;
+    first->prev->next = slab;
+    first->prev = slab;
+    if (slab->free_slots) list->slabs = slab;
+}
+
+/**
+ * @brief internal function; takes slab out of the ring of slabs of list
+ */
+static void _dll_unlink_slab(dll_t *list, dll_slab_t *slab) {
+    if (slab->next == slab) {
+        list->slabs = NULL;
         return;
     }
-    while (1) {
-        printf("[");
-        if (func) {
-            if (mode == REFERENCE) {
-                (*func)(*(void **)curr->data);
-            } else { // VALUE
-                (*func)(curr->data);
-            }
-        }
-        printf("]");
-        if ((curr = curr->next) != end) printf("<=>");
-        else break;
+    slab->prev->next = slab->next;
+    slab->next->prev = slab->prev;
+    if (list->slabs == slab) list->slabs = slab->next;
+}
+
+/**
+ * @brief internal function; allocates a slab of unused slots
+ * (see _dll_slab_capacity); the free slots are in address order
+ *
+ * @return dll_slab_t* new slab (not in a ring) or NULL
+ */
+static dll_slab_t *_dll_new_slab(size_t data_size) {
+    size_t slot_size = _dll_slot_size(data_size);
+    int capacity = _dll_slab_capacity(data_size);
+    size_t header = (sizeof(dll_slab_t) + DLL_ALIGN - 1) / DLL_ALIGN * DLL_ALIGN;
+    void *memory = NULL;
+    if (posix_memalign(&memory, DLL_SLAB_SIZE, header + capacity * slot_size) != 0) {
+        error("_dll_new_slab", "Could not allocate memory");
+        return NULL;
     }
-    printf(" rev: ");
-    curr = end->prev;
-    if (curr == end) {
-        printf("empty2\n");
-        return;
+    dll_slab_t *slab = memory;
+    slab->prev = NULL;
+    slab->next = NULL;
+    slab->free_slots = NULL;
+    slab->capacity = capacity;
+    slab->used = 0;
+    slab->moving = 0;
+    slab->reserved = false;
+    unsigned char *slots = _dll_slab_slots(slab);
+    for (int i = capacity - 1; i >= 0; --i) {
+        dll_node_t *slot = (dll_node_t *)(slots + i * slot_size);
+        slot->in_slab = 1;
+        slot->next = slab->free_slots;
+        slab->free_slots = slot;
     }
-    while (1) {
-        printf("[");
-        if (func) {
-            if (mode == REFERENCE) {
-                (*func)(*(void **)curr->data);
-            } else { // VALUE
-                (*func)(curr->data);
+    return slab;
+}
+
+/**
+ * @brief internal function; adds slabs with room for count nodes to list
+ *
+ * @param reserved see dll_reserve
+ * @return false if memory could not be allocated (no slab gets added)
+ */
+static bool _dll_add_slabs(dll_t *list, int count, bool reserved) {
+    int capacity = _dll_slab_capacity(list->data_size);
+    dll_slab_t *added = NULL; // linked by next
+    for (int i = 0; i < count; i += capacity) {
+        dll_slab_t *slab = _dll_new_slab(list->data_size);
+        if (!slab) {
+            while (added) {
+                slab = added;
+                added = slab->next;
+                free(slab);
             }
+            return false;
         }
-        printf("]");
-        if ((curr = curr->prev) != end) printf("<=>");
-        else break;
+        slab->reserved = reserved;
+        slab->next = added;
+        added = slab;
     }
-    
-    printf("\n");
+    while (added) {
+        dll_slab_t *slab = added;
+        added = slab->next;
+        _dll_link_slab(list, slab);
+    }
+    return true;
 }
 
-static void _dll_insert_from_begin(dll_t *list, int pos, void *data) {
-    if(!list) {
-        error("dll_insert", "list is null");
-        return;
-    }
-    if(pos > list->size || pos < 0) {
-        error("dll_insert", "index out of range");
-        return;
-    }
-    dll_node_t *new_node = _dll_new_node(list->op_mode, list->data_size, data);
-    if (!new_node) return;
-    dll_node_t *node = list->end->next;
-    while (pos) {
-        node = node->next;
-        --pos;
+/**
+ * @brief internal function; takes a free slot of the first slab of list
+ * a slab that gets full moves to the back of the ring
+ *
+ * @return dll_node_t* slot or NULL if no slab has a free slot
+ */
+static dll_node_t *_dll_take_slot(dll_t *list) {
+    dll_slab_t *slab = list->slabs;
+    if (!slab || !slab->free_slots) return NULL;
+    dll_node_t *slot = slab->free_slots;
+    slab->free_slots = slot->next;
+    slab->used++;
+    if (!slab->free_slots) list->slabs = slab->next;
+    return slot;
+}
+
+/**
+ * @brief internal function; frees a ring of slabs
+ * nodes inside the slabs must not be used afterwards
+ */
+static void _dll_free_slabs(dll_slab_t *slabs) {
+    if (!slabs) return;
+    slabs->prev->next = NULL;
+    while (slabs) {
+        dll_slab_t *slab = slabs;
+        slabs = slab->next;
+        free(slab);
     }
-    new_node->prev = node->prev;
-    new_node->next = node;
-    node->prev->next = new_node;
-    node->prev = new_node;
-    list->size++;
 }
 
 /**
- * @brief internal function that inserts data (counts from end)
- * pos=0 : last element
+ * @brief internal function; user data of node as passed to user functions
+ * (the stored reference in REFERENCE mode)
  */
-static void _dll_insert_from_end(dll_t *list, int pos, void *data) {
-    if(!list) {
-        error("dll_insert", "list is null");
-        return;
+static void *_dll_user_data(dll_t *list, dll_node_t *node) {
+    if (list->op_mode == REFERENCE) {
+        return *(void **)node->data;
+    } else { // VALUE
+        return node->data;
     }
-    if(pos > list->size || pos < 0) {
-        error("dll_insert", "index out of range");
-        return;
+}
+
+/**
+ * @brief internal function; allocates an empty index
+ *
+ * @param capacity number of entries (power of two)
+ * @return dll_index_t* index or NULL
+ */
+static dll_index_t *_dll_new_index(size_t capacity) {
+    dll_index_t *index = malloc(sizeof(*index) + capacity * sizeof(index->entries[0]));
+    if (!index) {
+        error("_dll_new_index", "Could not allocate memory");
+        return NULL;
     }
-    dll_node_t *new_node = _dll_new_node(list->op_mode, list->data_size, data);
-    if (!new_node) return;
-    dll_node_t *node = list->end->prev;
-    while (pos) {
-        node = node->prev;
-        --pos;
+    index->capacity = capacity;
+    index->count = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        index->entries[i].node = NULL;
     }
-    new_node->prev = node;
-    new_node->next = node->next;
-    node->next->prev = new_node;
-    node->next = new_node;
-    list->size++;
+    return index;
 }
 
-// see dll.h
-void dll_insert(dll_t *list, int pos, void *data) {
-    if (pos < 0) {
-        _dll_insert_from_end(list, -pos-1, data);
-    } else {
-        _dll_insert_from_begin(list, pos, data);
+/**
+ * @brief internal function; stores node in the first free entry for hash
+ * the index needs a free entry (see _dll_index_reserve)
+ */
+static void _dll_index_put(dll_index_t *index, dll_node_t *node, size_t hash) {
+    size_t mask = index->capacity - 1;
+    size_t i = hash & mask;
+    while (index->entries[i].node) i = (i + 1) & mask;
+    index->entries[i].node = node;
+    index->entries[i].hash = hash;
+    index->count++;
+}
+
+/**
+ * @brief internal function; grows the index of list to hold count nodes
+ * with a load factor of at most 1/2
+ *
+ * @return false if memory could not be allocated (index stays unchanged)
+ */
+static bool _dll_index_reserve(dll_t *list, size_t count) {
+    dll_index_t *index = list->index;
+    if (!index || count * 2 <= index->capacity) return true;
+    size_t capacity = index->capacity;
+    while (count * 2 > capacity) capacity *= 2;
+    dll_index_t *grown = _dll_new_index(capacity);
+    if (!grown) return false;
+    for (size_t i = 0; i < index->capacity; ++i) {
+        if (index->entries[i].node) {
+            _dll_index_put(grown, index->entries[i].node, index->entries[i].hash);
+        }
     }
+    free(index);
+    list->index = grown;
+    return true;
 }
 
-// see dll.h
-void dll_push_front(dll_t *list, void *data) {
-    if(!list) {
-        error("dll_push_front", "list is null");
-        return;
+/**
+ * @brief internal function; adds node to the index of list
+ */
+static void _dll_index_add(dll_t *list, dll_node_t *node) {
+    _dll_index_put(list->index, node, (*list->hash)(_dll_user_data(list, node)));
+}
+
+/**
+ * @brief internal function; removes node from the index of list
+ */
+static void _dll_index_remove(dll_t *list, dll_node_t *node) {
+    dll_index_t *index = list->index;
+    size_t mask = index->capacity - 1;
+    size_t i = (*list->hash)(_dll_user_data(list, node)) & mask;
+    while (index->entries[i].node != node) {
+        if (!index->entries[i].node) {
+            // hash of the data changed after insert; search everything
+            i = 0;
+            while (index->entries[i].node != node) ++i;
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    // move following entries of the cluster into the gap (no tombstones)
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (!index->entries[j].node) break;
+        size_t home = index->entries[j].hash & mask;
+        bool movable = i < j ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable) {
+            index->entries[i] = index->entries[j];
+            i = j;
+        }
     }
-    _dll_insert_from_begin(list, 0, data);
+    index->entries[i].node = NULL;
+    index->count--;
 }
 
-// see dll.h
-void dll_push_back(dll_t *list, void *data) {
-    if(!list) {
-        error("dll_push_back", "list is null");
-        return; 
+/**
+ * @brief internal function; finds a node holding data equal to data
+ *
+ * @return dll_node_t* node or NULL
+ */
+static dll_node_t *_dll_index_find(dll_t *list, void *data) {
+    dll_index_t *index = list->index;
+    size_t mask = index->capacity - 1;
+    size_t hash = (*list->hash)(data);
+    for (size_t i = hash & mask; index->entries[i].node; i = (i + 1) & mask) {
+        dll_node_t *node = index->entries[i].node;
+        if (index->entries[i].hash == hash
+            && (*list->equal)(_dll_user_data(list, node), data)) {
+            return node;
+        }
     }
-    _dll_insert_from_end(list, 0, data);
+    return NULL;
 }
 
-// see dll.h
-int dll_size(dll_t *list) {
-    if (!list) {
-        error("dll_count", "list is null");
-        return -1;
+/**
+ * @brief internal function; fills the index of list again (nodes changed)
+ */
+static void _dll_index_rebuild(dll_t *list) {
+    dll_index_t *index = list->index;
+    for (size_t i = 0; i < index->capacity; ++i) {
+        index->entries[i].node = NULL;
+    }
+    index->count = 0;
+    for (dll_node_t *node = list->end->next; node != list->end; node = node->next) {
+        _dll_index_add(list, node);
     }
-    return list->size;
 }
 
-// internal function
-static void *_dll_remove_from_end(dll_t *list, int pos, void *dest) {
-    if(!list) {
-        error("dll_remove", "list is null");
+// see dll.h
+dll_t *dll_new_indexed(op_mode mode, size_t data_size, hash_fun hash, equal_fun equal) {
+    if (!hash || !equal) {
+        error("dll_new_indexed", "hash or equal function is null");
         return NULL;
     }
-    if(pos >= list->size || pos < 0) {
-        error("dll_remove", "index out of range");
+    dll_t *list = dll_new(mode, data_size);
+    if (!list) return NULL;
+    list->index = _dll_new_index(DLL_INDEX_MIN);
+    if (!list->index) {
+        dll_delete(list, NULL);
         return NULL;
     }
-    dll_node_t *end = list->end;
-    dll_node_t *node = end->prev;
-    while (pos) {
-        node = node->prev;
-        --pos;
-    }
-    node->prev->next = node->next;
-    node->next->prev = node->prev;
-    node->next = NULL;
-    node->prev = NULL;
-    list->size--;
-    return _dll_remove_node(list, node, dest);
+    list->hash = hash;
+    list->equal = equal;
+    return list;
 }
 
-// interal function
-static void *_dll_remove_from_begin(dll_t *list, int pos, void *dest) {
-    if(!list) {
-        error("dll_remove", "list is null");
+// see dll.h
+dll_t *dll_new_ring(op_mode mode, size_t data_size) {
+    dll_t *list = dll_new(mode, data_size);
+    if (!list) return NULL;
+    list->ring = malloc(DLL_RING_MIN * list->data_size);
+    if (!list->ring) {
+        error("dll_new_ring", "Could not allocate enough memory");
+        dll_delete(list, NULL);
         return NULL;
     }
-    if(pos >= list->size || pos < 0) {
-        error("dll_remove", "index out of range");
+    list->ring_capacity = DLL_RING_MIN;
+    return list;
+}
+
+/**
+ * @brief internal function; element at physical index phys of a ring list
+ * phys may be size (the slot after the last element)
+ */
+static unsigned char *_dll_ring_phys(dll_t *list, int phys) {
+    int slot = (list->ring_head + phys) & (list->ring_capacity - 1);
+    return list->ring + slot * list->data_size;
+}
+
+/**
+ * @brief internal function; element at index pos of a ring list
+ */
+static unsigned char *_dll_ring_at(dll_t *list, int pos) {
+    return _dll_ring_phys(list, list->reversed ? list->size - 1 - pos : pos);
+}
+
+/**
+ * @brief internal function; user data of a ring element
+ */
+static void *_dll_ring_user_data(dll_t *list, unsigned char *elem) {
+    if (list->op_mode == REFERENCE) {
+        return *(void **)elem;
+    } else { // VALUE
+        return elem;
+    }
+}
+
+/**
+ * @brief internal function; moves the elements of a ring list into a new
+ * buffer (in list order, starting at slot 0); clears the reversed flag
+ *
+ * @param capacity new number of slots (power of two, at least size)
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_ring_resize(dll_t *list, int capacity) {
+    unsigned char *ring = malloc(capacity * list->data_size);
+    if (!ring) {
+        error("_dll_ring_resize", "Could not allocate memory");
+        return false;
+    }
+    for (int i = 0; i < list->size; ++i) {
+        memcpy(ring + i * list->data_size, _dll_ring_at(list, i), list->data_size);
+    }
+    free(list->ring);
+    list->ring = ring;
+    list->ring_capacity = capacity;
+    list->ring_head = 0;
+    list->reversed = false;
+    return true;
+}
+
+/**
+ * @brief internal function; inserts data in front of index pos (ring list)
+ * moves the elements of the shorter side by one slot
+ *
+ * @return false if memory could not be allocated
+ */
+static bool _dll_ring_insert(dll_t *list, int pos, void *data) {
+    if (list->size == list->ring_capacity
+        && !_dll_ring_resize(list, list->ring_capacity * 2)) {
+        return false;
+    }
+    size_t data_size = list->data_size;
+    int phys = list->reversed ? list->size - pos : pos;
+    if (phys < list->size - phys) {
+        // move [0, phys) one slot to the front
+        list->ring_head = (list->ring_head - 1) & (list->ring_capacity - 1);
+        for (int i = 0; i < phys; ++i) {
+            memcpy(_dll_ring_phys(list, i), _dll_ring_phys(list, i + 1), data_size);
+        }
+    } else {
+        // move [phys, size) one slot to the back
+        for (int i = list->size; i > phys; --i) {
+            memcpy(_dll_ring_phys(list, i), _dll_ring_phys(list, i - 1), data_size);
+        }
+    }
+    unsigned char *elem = _dll_ring_phys(list, phys);
+    if (list->op_mode == REFERENCE) {
+        *(void **)elem = data;
+    } else { // VALUE
+        memcpy(elem, data, data_size);
+    }
+    list->size++;
+    return true;
+}
+
+/**
+ * @brief internal function; removes element at index pos (ring list)
+ * moves the elements of the shorter side by one slot
+ *
+ * @return see dll_remove
+ */
+static void *_dll_ring_remove(dll_t *list, int pos, void *dest) {
+    size_t data_size = list->data_size;
+    int phys = list->reversed ? list->size - 1 - pos : pos;
+    unsigned char *elem = _dll_ring_phys(list, phys);
+    void *result = dest;
+    if (list->op_mode == REFERENCE) {
+        result = *(void **)elem;
+    } else if (dest) { // VALUE
+        memcpy(dest, elem, data_size);
+    }
+    if (phys < list->size - 1 - phys) {
+        // move [0, phys) one slot to the back
+        for (int i = phys; i > 0; --i) {
+            memcpy(_dll_ring_phys(list, i), _dll_ring_phys(list, i - 1), data_size);
+        }
+        list->ring_head = (list->ring_head + 1) & (list->ring_capacity - 1);
+    } else {
+        // move (phys, size) one slot to the front
+        for (int i = phys; i < list->size - 1; ++i) {
+            memcpy(_dll_ring_phys(list, i), _dll_ring_phys(list, i + 1), data_size);
+        }
+    }
+    list->size--;
+    return result;
+}
+
+/**
+ * @brief internal function; stable bottom-up mergesort of a ring list
+ * same order as the mergesort of linked lists
+ */
+static void _dll_ring_sort(dll_t *list, cmp c) {
+    int n = list->size;
+    size_t data_size = list->data_size;
+    if (!_dll_ring_resize(list, list->ring_capacity)) return; // linear, not reversed
+    unsigned char *tmp = malloc(n * data_size);
+    if (!tmp) {
+        error("dll_sort", "Could not allocate memory");
+        return;
+    }
+    unsigned char *from = list->ring;
+    unsigned char *to = tmp;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int l = lo;
+            int r = mid;
+            for (int k = lo; k < hi; ++k) {
+                bool take_r = l >= mid;
+                if (l < mid && r < hi) {
+                    void *dl = _dll_ring_user_data(list, from + l * data_size);
+                    void *dr = _dll_ring_user_data(list, from + r * data_size);
+                    take_r = (*c)(dl, dr) < 0;
+                }
+                int src = take_r ? r++ : l++;
+                memcpy(to + k * data_size, from + src * data_size, data_size);
+            }
+        }
+        unsigned char *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != list->ring) memcpy(list->ring, from, n * data_size);
+    free(tmp);
+}
+
+/**
+ * @brief internal function; index of the first element equal to data in a
+ * ring list; compares bytes (VALUE) or pointers (REFERENCE)
+ *
+ * @return int index or -1
+ */
+static int _dll_ring_find(dll_t *list, void *data) {
+    for (int i = 0; i < list->size; ++i) {
+        unsigned char *elem = _dll_ring_at(list, i);
+        if (list->op_mode == REFERENCE) {
+            if (*(void **)elem == data) return i;
+        } else if (memcmp(elem, data, list->data_size) == 0) { // VALUE
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief internal function; allocates new node and copying data
+ * a free slab slot is used if available, malloc otherwise
+ * 
+ * @param list list the node will belong to
+ * @param data data to insert (copy)
+ * @return (dll_node_t *) node pointer
+ */
+static dll_node_t *_dll_new_node(dll_t *list, void *data) {
+    dll_node_t *node = _dll_take_slot(list);
+    if (!node) {
+        node = malloc(sizeof(*node) + list->data_size);
+        if (!node) {
+            error("_dll_new_node", "Could not allocate memory");
+            return NULL;
+        }
+        node->in_slab = 0;
+    }
+    node->prev = NULL;
+    node->next = NULL;
+    node->born = list->epoch;
+    node->died = 0;
+    if (list->op_mode == REFERENCE) {
+        *(void **)node->data = data;
+    } else { // VALUE
+        memcpy(node->data, data, list->data_size);
+    }
+    
+    return node;
+}
+
+/**
+ * @brief deletes a node and optionally its data
+ * slab slots are given back to their slab; empty slabs get freed
+ * 
+ * @param list list the node belongs to (holds its slab)
+ * @param node node to delete
+ * @param func user data delete function
+ */
+static void _dll_delete_node(dll_t *list, dll_node_t *node, delete_data_fun func) {
+    if (!node) {
+        error("_dll_delete_node", "node is null");
+        return;
+    }
+    if (func) {
+        if (list->op_mode == REFERENCE) {
+            (*func)(*(void **)node->data);
+        } else { // VALUE
+            (*func)(node->data);
+        }
+    }
+    dll_slab_t *slab = _dll_node_slab(node);
+    if (!slab) {
+        free(node);
+        return;
+    }
+    bool was_full = !slab->free_slots;
+    node->next = slab->free_slots;
+    slab->free_slots = node;
+    if (--slab->used == 0 && !slab->reserved) {
+        _dll_unlink_slab(list, slab);
+        free(slab);
+    } else if (was_full) {
+        // slabs with free slots come first
+        _dll_unlink_slab(list, slab);
+        _dll_link_slab(list, slab);
+    }
+}
+
+/**
+ * @brief gets called when a node gets removed from the list and returns data
+ * a node snapshots still see (see _dll_retire) is not deleted
+ * 
+ * @param m 
+ * @param node 
+ * @return void* 
+ */
+static void *_dll_remove_node(dll_t *list, dll_node_t *node, void *dest) {
+    if (!list || !node) {
+        error("_dll_remove_node", "node is null");
         return NULL;
     }
+    op_mode m = list->op_mode;
+    void *result = dest;
+    if (m == REFERENCE) {
+        result = *(void **)node->data;
+    } else if (dest) {
+        memcpy(dest, node->data, list->data_size);
+    }
+    if (node->died == 0) _dll_delete_node(list, node, NULL);
+    return result;
+}
+
+/**
+ * @brief internal function; frees all nodes, slabs and the end node
+ *
+ * @param list
+ * @param func user data delete function
+ */
+static void _dll_free_nodes(dll_t *list, delete_data_fun func) {
     dll_node_t *end = list->end;
+    dll_node_t *curr = end->next;
+    dll_node_t *tmp;
+    while (curr != end) {
+        tmp = curr;
+        curr = curr->next;
+        _dll_delete_node(list, tmp, func);
+    }
+    if (list->ring && func) {
+        for (int i = 0; i < list->size; ++i) {
+            (*func)(_dll_ring_user_data(list, _dll_ring_phys(list, i)));
+        }
+    }
+    free(list->ring);
+    _dll_free_slabs(list->slabs);
+    free(list->index);
+    free(end);
+}
+
+/**
+ * @brief internal function; frees the nodes the writer left to its
+ * snapshots (see _dll_leave) and share itself
+ * the delete function of the writer is only called on nodes it did not
+ * remove
+ *
+ * @param list last list that used share (gives mode and data size)
+ */
+static void _dll_free_share(dll_t *list, dll_share_t *share) {
+    delete_data_fun func = share->func;
+    for (int i = share->removed_head; i < share->removed_linked; ++i) {
+        dll_node_t *node = share->removed[i].node;
+        if (!node->in_slab) free(node);
+    }
+    dll_node_t *end = share->end;
     dll_node_t *node = end->next;
-    while (pos) {
-        node = node->next;
-        --pos;
+    while (node != end) {
+        dll_node_t *next = node->next;
+        if (func && node->died == 0) (*func)(_dll_user_data(list, node));
+        if (!node->in_slab) free(node);
+        node = next;
     }
-    node->prev->next = node->next;
-    node->next->prev = node->prev;
-    node->next = NULL;
-    node->prev = NULL;
-    list->size--;
-    return _dll_remove_node(list, node, dest);
+    free(end);
+    _dll_free_slabs(share->slabs);
+    while (share->oldest) {
+        dll_epoch_t *oldest = share->oldest;
+        share->oldest = oldest->next;
+        free(oldest);
+    }
+    free(share->removed);
+    free(share);
 }
 
-void *dll_remove(dll_t *list, int pos, void *dest) {
-    if (pos < 0) {
-        return _dll_remove_from_end(list, -pos-1, dest);
+/**
+ * @brief internal function; list stops using the nodes it shares with
+ * snapshots (or with its writer); a writer leaves its nodes, slabs and
+ * index behind, so the caller has to give list new ones (or free it)
+ * the last list using the nodes frees them
+ *
+ * @param func user data delete function (see dll_delete); the one of the
+ * writer is kept for the last list; a snapshot does not own the data
+ */
+static void _dll_leave(dll_t *list, delete_data_fun func) {
+    dll_share_t *share = list->share;
+    list->share = NULL;
+    if (list->snapshot) {
+        DLL_ATOMIC_ADD(&list->snapshot->snapshots, -1);
+        list->snapshot = NULL;
+    } else if (!list->ring) {
+        share->end = list->end;
+        share->slabs = list->slabs;
+        share->func = func;
+        list->slabs = NULL;
+        free(list->index);
+        list->index = NULL;
+    } else if (func) {
+        // the lists sharing a ring buffer are all alike; any of them may
+        // own the data
+        share->func = func;
+    }
+    if (DLL_ATOMIC_ADD(&share->refs, -1) > 0) return;
+    if (list->ring) {
+        // ring lists copy on write; the buffer of list is the shared one
+        _dll_free_nodes(list, share->func);
+        free(share);
     } else {
-        return _dll_remove_from_begin(list, pos, dest);
+        _dll_free_share(list, share);
     }
 }
 
-void *dll_pop_back(dll_t *list, void *dest){
-    return _dll_remove_from_end(list, 0, dest);
-} 
+/**
+ * @brief internal function; finishes removals of the writer of shared
+ * nodes: unlinks removed nodes no snapshot sees anymore and frees unlinked
+ * nodes no reader can stand on anymore (every snapshot older than the
+ * unlink is gone); drops the share once list is its only user
+ * starts a new epoch if a snapshot sees the current one
+ */
+static void _dll_reclaim(dll_t *list) {
+    dll_share_t *share = list->share;
+    if (list->epoch_seen) {
+        list->epoch++;
+        list->epoch_seen = false;
+    }
+    while (share->oldest && DLL_ATOMIC_LOAD(&share->oldest->snapshots) == 0) {
+        dll_epoch_t *oldest = share->oldest;
+        share->oldest = oldest->next;
+        free(oldest);
+    }
+    if (!share->oldest) share->newest = NULL;
+    bool all = !share->oldest; // no snapshot left
+    uint32_t oldest = all ? 0 : share->oldest->epoch;
 
-void *dll_pop_front(dll_t *list, void *dest){
-    return _dll_remove_from_begin(list, 0, dest);
+    // a snapshot of an epoch >= the removal does not see the node
+    while (share->removed_linked < share->removed_count
+        && (all || share->removed[share->removed_linked].epoch <= oldest)) {
+        dll_node_t *node = share->removed[share->removed_linked].node;
+        DLL_ATOMIC_STORE(&node->prev->next, node->next);
+        DLL_ATOMIC_STORE(&node->next->prev, node->prev);
+        share->removed[share->removed_linked++].epoch = list->epoch;
+    }
+    // a snapshot of an epoch >= the unlink never reached the node
+    while (share->removed_head < share->removed_linked
+        && (all || share->removed[share->removed_head].epoch <= oldest)) {
+        _dll_delete_node(list, share->removed[share->removed_head++].node, NULL);
+    }
+    int done = share->removed_head;
+    if (done > 0 && done * 2 >= share->removed_count) {
+        memmove(share->removed, share->removed + done,
+            (share->removed_count - done) * sizeof(*share->removed));
+        share->removed_head = 0;
+        share->removed_linked -= done;
+        share->removed_count -= done;
+    }
+    if (all && share->removed_count == 0 && DLL_ATOMIC_LOAD(&share->refs) == 1) {
+        free(share->removed);
+        free(share);
+        list->share = NULL;
+    }
 }
 
-static void *_dll_peek_from_end(dll_t *list, int pos) {
-    if(!list) {
-        error("dll_peek", "list is null");
+/**
+ * @brief internal function; takes node out of the list while snapshots may
+ * see it: node stays linked, marked with the epoch of the removal, until
+ * _dll_reclaim unlinks and frees it
+ *
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_retire(dll_t *list, dll_node_t *node) {
+    dll_share_t *share = list->share;
+    if (share->removed_count == share->removed_capacity) {
+        int capacity = share->removed_capacity ? 2 * share->removed_capacity : DLL_REMOVED_MIN;
+        void *removed = realloc(share->removed, capacity * sizeof(*share->removed));
+        if (!removed) {
+            error("_dll_retire", "Could not allocate memory");
+            return false;
+        }
+        share->removed = removed;
+        share->removed_capacity = capacity;
+    }
+    share->removed[share->removed_count].node = node;
+    share->removed[share->removed_count++].epoch = list->epoch;
+    DLL_ATOMIC_STORE(&node->died, list->epoch);
+    if (node == list->live_first) list->live_first = _dll_step_shared(list, node, true);
+    if (node == list->live_last) list->live_last = _dll_step_shared(list, node, false);
+    list->size--;
+    if (list->index) _dll_index_remove(list, node);
+    return true;
+}
+
+/**
+ * @brief internal function; makes the nodes of list private before they get
+ * relinked; list gets a copy of the nodes it sees (new slabs); its writer
+ * or its snapshots keep the old nodes
+ *
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_unshare(dll_t *list) {
+    if (!list->share) return true;
+    if (!list->ring && !list->snapshot) {
+        _dll_reclaim(list);
+        if (!list->share) return true;
+    } else if (list->ring && DLL_ATOMIC_LOAD(&list->share->refs) == 1) {
+        free(list->share);
+        list->share = NULL;
+        return true;
+    }
+    dll_t copy = *list;
+    copy.slabs = NULL;
+    copy.share = NULL;
+    copy.snapshot = NULL;
+    copy.epoch = 1;
+    copy.epoch_seen = false;
+    copy.finger = NULL;
+    copy.index = NULL;
+    copy.end = malloc(sizeof(*copy.end));
+    if (!copy.end) {
+        error("_dll_unshare", "Could not allocate memory");
+        return false;
+    }
+    copy.end->next = copy.end;
+    copy.end->prev = copy.end;
+    copy.end->in_slab = 0;
+    if (list->ring) {
+        size_t ring_size = list->ring_capacity * list->data_size;
+        copy.ring = malloc(ring_size);
+        if (!copy.ring) {
+            error("_dll_unshare", "Could not allocate memory");
+            free(copy.end);
+            return false;
+        }
+        memcpy(copy.ring, list->ring, ring_size);
+        _dll_leave(list, NULL);
+        *list = copy;
+        return true;
+    }
+    if (list->hash) {
+        size_t capacity = DLL_INDEX_MIN;
+        while (capacity < 2 * (size_t)list->size) capacity *= 2;
+        if (!(copy.index = _dll_new_index(capacity))) {
+            free(copy.end);
+            return false;
+        }
+    }
+    if (!_dll_add_slabs(&copy, list->size, false)) {
+        free(copy.index);
+        free(copy.end);
+        return false;
+    }
+    // copy in logical order; the writer marks its old nodes as removed, so
+    // the last snapshot does not pass them to the delete function
+    dll_node_t *prev = copy.end;
+    dll_node_t *node = _dll_next(list, list->end);
+    for (; node != list->end; node = _dll_next(list, node)) {
+        dll_node_t *slot = _dll_take_slot(&copy);
+        memcpy(slot->data, node->data, list->data_size);
+        slot->born = copy.epoch;
+        slot->died = 0;
+        slot->prev = prev;
+        prev->next = slot;
+        prev = slot;
+        if (copy.index) _dll_index_add(&copy, slot);
+        if (!list->snapshot) DLL_ATOMIC_STORE(&node->died, list->epoch);
+    }
+    prev->next = copy.end;
+    copy.end->prev = prev;
+    copy.reversed = false;
+
+    _dll_leave(list, NULL);
+    *list = copy;
+    return true;
+}
+
+/**
+ * @brief internal function; prepares list for inserting or removing single
+ * nodes; nodes shared with snapshots stay where they are (see _dll_retire),
+ * only ring lists and snapshots get a private copy
+ * once the epochs run out, the nodes get new ones (or a copy while
+ * snapshots exist)
+ *
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_write(dll_t *list) {
+    if (list->share && (list->ring || list->snapshot)) return _dll_unshare(list);
+    if (list->share) _dll_reclaim(list);
+    if (list->share && list->epoch >= DLL_EPOCH_MAX && !_dll_unshare(list)) return false;
+    if (list->epoch >= DLL_EPOCH_MAX) {
+        for (dll_node_t *node = list->end->next; node != list->end; node = node->next) {
+            node->born = 1;
+        }
+        list->epoch = 1;
+    }
+    return true;
+}
+
+// see dll.h
+void dll_delete(dll_t *list, delete_data_fun func) {
+    if (!list) return;
+    if (list->share && !list->ring && !list->snapshot) _dll_reclaim(list);
+    if (list->share) _dll_leave(list, func);
+    else _dll_free_nodes(list, func);
+    free(list);
+}
+
+// see dll.h
+bool dll_reserve(dll_t *list, int count) {
+    if (!list) {
+        error("dll_reserve", "list is null");
+        return false;
+    }
+    if (count <= 0) return true;
+    if (!_dll_write(list)) return false;
+    if (list->ring) {
+        int capacity = list->ring_capacity;
+        while (capacity < list->size + count) capacity *= 2;
+        return capacity == list->ring_capacity || _dll_ring_resize(list, capacity);
+    }
+    return _dll_add_slabs(list, count, true);
+}
+
+// see dll.h
+dll_t *dll_snapshot(dll_t *list) {
+    if (!list) {
+        error("dll_snapshot", "list is null");
         return NULL;
     }
-    if(pos >= list->size || pos < 0) {
-        error("dll_peek", "index out of range");
+    dll_t *snapshot = malloc(sizeof(*snapshot));
+    if (!snapshot) {
+        error("dll_snapshot", "Could not allocate enough memory");
         return NULL;
     }
+    dll_share_t *share = list->share;
+    if (!share) {
+        share = malloc(sizeof(*share));
+        if (!share) {
+            error("dll_snapshot", "Could not allocate enough memory");
+            free(snapshot);
+            return NULL;
+        }
+        share->refs = 1;
+        share->oldest = NULL;
+        share->newest = NULL;
+        share->removed = NULL;
+        share->removed_head = 0;
+        share->removed_linked = 0;
+        share->removed_count = 0;
+        share->removed_capacity = 0;
+        share->end = NULL;
+        share->slabs = NULL;
+        share->func = NULL;
+        list->live_first = NULL; // nodes were relinked without a share
+        list->live_last = NULL;
+    }
+    // a snapshot of a snapshot sees the same epoch
+    dll_epoch_t *record = list->snapshot;
+    if (!record && !list->ring) {
+        record = share->newest;
+        if (!record || record->epoch != list->epoch) {
+            record = malloc(sizeof(*record));
+            if (!record) {
+                error("dll_snapshot", "Could not allocate enough memory");
+                if (!list->share) free(share);
+                free(snapshot);
+                return NULL;
+            }
+            record->next = NULL;
+            record->epoch = list->epoch;
+            record->snapshots = 0;
+            if (share->newest) share->newest->next = record;
+            else share->oldest = record;
+            share->newest = record;
+        }
+        list->epoch_seen = true;
+    }
+    list->share = share;
+    DLL_ATOMIC_ADD(&share->refs, 1);
+    *snapshot = *list;
+    snapshot->finger = NULL;
+    if (record) {
+        DLL_ATOMIC_ADD(&record->snapshots, 1);
+        snapshot->snapshot = record;
+        snapshot->slabs = NULL;
+        snapshot->index = NULL;
+    }
+    return snapshot;
+}
+
+// see dll.h
+/**
+ * @todo refactor
+ */
+void dll_display(dll_t *list, display_data_fun func) {
+    if (!list) {
+        printf("null\n");
+        return;
+    }
+    if (list->ring) {
+        if (list->size == 0) {
+            printf("empty1\n");
+            return;
+        }
+        for (int i = 0; i < list->size; ++i) {
+            printf(i ? "<=>[" : "[");
+            if (func) (*func)(_dll_ring_user_data(list, _dll_ring_at(list, i)));
+            printf("]");
+        }
+        printf(" rev: ");
+        for (int i = list->size - 1; i >= 0; --i) {
+            printf(i < list->size - 1 ? "<=>[" : "[");
+            if (func) (*func)(_dll_ring_user_data(list, _dll_ring_at(list, i)));
+            printf("]");
+        }
+        printf("\n");
+        return;
+    }
     dll_node_t *end = list->end;
-    dll_node_t *node = end->prev;
-    while (pos) {
-        node = node->prev;
-        --pos;
+    dll_node_t *curr = _dll_next(list, end);
+    op_mode mode = list->op_mode;
+    if (curr == end) {
+        printf("empty1\n");
+        return;
+    }
+    while (1) {
+        printf("[");
+        if (func) {
+            if (mode == REFERENCE) {
+                (*func)(*(void **)curr->data);
+            } else { // VALUE
+                (*func)(curr->data);
+            }
+        }
+        printf("]");
+        if ((curr = _dll_next(list, curr)) != end) printf("<=>");
+        else break;
+    }
+    printf(" rev: ");
+    curr = _dll_prev(list, end);
+    if (curr == end) {
+        printf("empty2\n");
+        return;
+    }
+    while (1) {
+        printf("[");
+        if (func) {
+            if (mode == REFERENCE) {
+                (*func)(*(void **)curr->data);
+            } else { // VALUE
+                (*func)(curr->data);
+            }
+        }
+        printf("]");
+        if ((curr = _dll_prev(list, curr)) != end) printf("<=>");
+        else break;
+    }
+    
+    printf("\n");
+}
+
+/**
+ * @brief internal function; walks to the node at index pos
+ * the walk starts at the closest of: first node, end node or finger
+ * (last accessed node; wins ties); the reached node becomes the new finger
+ * pos=size returns the end node (useful as insert position)
+ *
+ * @param list
+ * @param pos index between 0 and size (both inclusive)
+ * @return dll_node_t* node at pos
+ */
+static dll_node_t *_dll_node_at(dll_t *list, int pos) {
+    int size = list->size;
+    bool from_end = size - pos < pos;
+    int steps = from_end ? pos - size : pos;
+    dll_node_t *node;
+    if (list->finger && abs(pos - list->finger_pos) <= abs(steps)) {
+        node = list->finger;
+        steps = pos - list->finger_pos;
+    } else {
+        // index size or index 0 (a step from the end node)
+        node = from_end ? list->end : _dll_next(list, list->end);
+    }
+    while (steps > 0) {
+        node = _dll_next(list, node);
+        --steps;
+    }
+    while (steps < 0) {
+        node = _dll_prev(list, node);
+        ++steps;
+    }
+    if (node != list->end) {
+        list->finger = node;
+        list->finger_pos = pos;
+    }
+    return node;
+}
+
+/**
+ * @brief internal function; inserts data in front of index pos
+ * pos=size appends data
+ *
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_insert_at(dll_t *list, int pos, void *data) {
+    if (!_dll_write(list) || !_dll_index_reserve(list, list->size + 1)) return false;
+    if (list->ring) return _dll_ring_insert(list, pos, data);
+    dll_node_t *new_node = _dll_new_node(list, data);
+    if (!new_node) return false;
+    dll_node_t *node = _dll_node_at(list, pos);
+    dll_node_t *prev = DLL_PREV(list, node); // removed nodes may lie between
+    _dll_set_prev(list, new_node, prev);
+    _dll_set_next(list, new_node, node);
+    _dll_set_next(list, prev, new_node);
+    _dll_set_prev(list, node, new_node);
+    if (list->share) {
+        // new first/last node the writer sees (see _dll_step_shared)
+        dll_node_t **first = list->reversed ? &list->live_last : &list->live_first;
+        dll_node_t **last = list->reversed ? &list->live_first : &list->live_last;
+        if (pos == 0) *first = new_node;
+        if (pos == list->size) *last = new_node;
+    }
+    list->size++;
+    if (list->index) _dll_index_add(list, new_node);
+    list->finger = new_node;
+    list->finger_pos = pos;
+    return true;
+}
+
+// see dll.h
+void dll_insert(dll_t *list, int pos, void *data) {
+    if(!list) {
+        error("dll_insert", "list is null");
+        return;
+    }
+    if (pos < 0) pos = list->size + pos + 1;
+    if(pos > list->size || pos < 0) {
+        error("dll_insert", "index out of range");
+        return;
+    }
+    _dll_insert_at(list, pos, data);
+}
+
+// see dll.h
+void dll_push_front(dll_t *list, void *data) {
+    if(!list) {
+        error("dll_push_front", "list is null");
+        return;
+    }
+    _dll_insert_at(list, 0, data);
+}
+
+// see dll.h
+void dll_push_back(dll_t *list, void *data) {
+    if(!list) {
+        error("dll_push_back", "list is null");
+        return; 
+    }
+    _dll_insert_at(list, list->size, data);
+}
+
+// see dll.h
+int dll_size(dll_t *list) {
+    if (!list) {
+        error("dll_count", "list is null");
+        return -1;
+    }
+    return list->size;
+}
+
+/**
+ * @brief internal function; takes node out of the list (node is kept)
+ * while snapshots exist, node stays linked for them (see _dll_retire)
+ *
+ * @return false if memory could not be allocated (list stays unchanged)
+ */
+static bool _dll_unlink(dll_t *list, dll_node_t *node) {
+    if (list->share) return _dll_retire(list, node);
+    dll_node_t *prev = DLL_PREV(list, node);
+    dll_node_t *next = DLL_NEXT(list, node);
+    _dll_set_next(list, prev, next);
+    _dll_set_prev(list, next, prev);
+    list->size--;
+    if (list->index) _dll_index_remove(list, node);
+    node->next = NULL;
+    node->prev = NULL;
+    return true;
+}
+
+/**
+ * @brief internal function; removes node at index pos
+ * the following node becomes the finger
+ */
+static void *_dll_remove_at(dll_t *list, int pos, void *dest) {
+    if(!list) {
+        error("dll_remove", "list is null");
+        return NULL;
+    }
+    if(pos >= list->size || pos < 0) {
+        error("dll_remove", "index out of range");
+        return NULL;
+    }
+    if (!_dll_write(list)) return NULL;
+    if (list->ring) return _dll_ring_remove(list, pos, dest);
+    dll_node_t *node = _dll_node_at(list, pos);
+    dll_node_t *next = _dll_next(list, node);
+    if (!_dll_unlink(list, node)) return NULL;
+    list->finger = NULL;
+    if (next != list->end) {
+        list->finger = next;
+        list->finger_pos = pos;
+    }
+    return _dll_remove_node(list, node, dest);
+}
+
+// see dll.h
+void *dll_remove(dll_t *list, int pos, void *dest) {
+    if (list && pos < 0) pos = list->size + pos;
+    return _dll_remove_at(list, pos, dest);
+}
+
+// see dll.h
+void *dll_pop_back(dll_t *list, void *dest){
+    if (!list) {
+        error("dll_pop_back", "list is null");
+        return NULL;
+    }
+    return _dll_remove_at(list, list->size - 1, dest);
+} 
+
+// see dll.h
+void *dll_pop_front(dll_t *list, void *dest){
+    return _dll_remove_at(list, 0, dest);
+}
+
+// see dll.h
+void *dll_peek(dll_t *list, int pos) {
+    if(!list) {
+        error("dll_peek", "list is null");
+        return NULL;
+    }
+    if (pos < 0) pos = list->size + pos;
+    if(pos >= list->size || pos < 0) {
+        error("dll_peek", "index out of range");
+        return NULL;
+    }
+    if (list->ring) return _dll_ring_user_data(list, _dll_ring_at(list, pos));
+    dll_node_t *node = _dll_node_at(list, pos);
+    if (list->op_mode == REFERENCE) {
+        return *(void **)node->data;
+    } else {
+        return node->data;
+    }
+}
+
+// see dll.h
+void dll_reverse(dll_t *list) {
+    if (!list) {
+        error("dll_reverse", "list is null");
+        return;
+    }
+    list->reversed = !list->reversed;
+    list->finger_pos = list->size - 1 - list->finger_pos;
+}
+
+/**
+ * @brief internal function; swaps prev and next of all nodes so that
+ * the physical order matches the logical order
+ *
+ * @return false if shared nodes could not be copied
+ */
+static bool _dll_materialize(dll_t *list) {
+    if (!list->reversed) return true;
+    if (!_dll_unshare(list)) return false;
+    if (!list->reversed) return true; // the copy is in logical order
+    if (list->ring) return _dll_ring_resize(list, list->ring_capacity);
+    dll_node_t *node = list->end;
+    dll_node_t *tmp;
+    dll_node_t *end = list->end;
+    do {
+        tmp = node->next;
+        node->next = node->prev;
+        node->prev = tmp;
+        node = tmp;
+    } while(node != end);
+    list->reversed = false;
+    return true;
+}
+
+// see dll.h
+void dll_materialize(dll_t *list) {
+    if (!list) {
+        error("dll_materialize", "list is null");
+        return;
+    }
+    _dll_materialize(list);
+}
+
+//see dll.h
+void dll_clear(dll_t *list) {
+    if (!list) {
+        error("dll_reverse", "list is null");
+        return;
+    }
+    if (list->share && !list->ring && !list->snapshot) _dll_reclaim(list);
+    if (list->share) {
+        // no need to copy shared nodes; start with a new end node
+        dll_node_t *end = malloc(sizeof(*end));
+        if (!end) {
+            error("dll_clear", "Could not allocate memory");
+            return;
+        }
+        dll_index_t *index = NULL;
+        if (list->hash && !(index = _dll_new_index(DLL_INDEX_MIN))) {
+            free(end);
+            return;
+        }
+        unsigned char *ring = NULL;
+        if (list->ring && !(ring = malloc(DLL_RING_MIN * list->data_size))) {
+            error("dll_clear", "Could not allocate memory");
+            free(index);
+            free(end);
+            return;
+        }
+        _dll_leave(list, NULL);
+        end->next = end;
+        end->prev = end;
+        end->in_slab = 0;
+        list->end = end;
+        list->index = index;
+        list->ring = ring;
+        list->ring_capacity = ring ? DLL_RING_MIN : 0;
+        list->ring_head = 0;
+        list->slabs = NULL;
+        list->finger = NULL;
+        list->size = 0;
+        return;
+    }
+    if (list->ring) {
+        if (!_dll_unshare(list)) return;
+        list->size = 0;
+        list->ring_head = 0;
+        return;
+    }
+    while (list->size > 0) {
+        _dll_remove_at(list, 0, NULL);
+    }
+}
+
+void dll_foreach(dll_t *list, foreach_fun func, void *usr) {
+    if(!list || !func) {
+        error("dll_foreach", "list or function is null");
+        return;
+    }
+    if (list->ring) {
+        for (int i = 0; i < list->size; ++i) {
+            (*func)(i, _dll_ring_user_data(list, _dll_ring_at(list, i)), usr);
+        }
+        return;
+    }
+    dll_node_t *node = _dll_next(list, list->end);
+    dll_node_t *end = list->end;
+    op_mode mode = list->op_mode;
+    int i = 0;
+    while(node != end) {
+        dll_node_t *next = _dll_next(list, node);
+        if (mode == REFERENCE) {
+            (*func)(i, *(void **)node->data, usr);
+        } else { // VALUE
+            (*func)(i, node->data, usr);
+        }
+        ++i;
+        node = next;
+    }
+}
+
+dlli_t *dll_iter(dll_t *list) {
+    if (!list) {
+        error("dll_iterator", "list is null");
+        return false;
+    }
+    dlli_t *iter = malloc(sizeof(*iter));
+    if (!iter) {
+        error("dll_iterator","Could not allocate enough memory");
+        return NULL;
+    }
+    iter->list = list;
+    iter->curr = list->end;
+    iter->pos = -1;
+    return iter;
+}
+
+void dlli_delete(dlli_t *iter) {
+    free(iter);
+}
+
+bool dlli_has_next(dlli_t *iter) {
+    if (!iter) {
+        error("dlli_has_next", "iterator is null");
+        return false;
+    }
+    if (iter->list->ring) return iter->pos + 1 < iter->list->size;
+    if (_dll_next(iter->list, iter->curr) != iter->list->end) {
+        return true;
+    }
+    return false;
+}
+
+bool dlli_has_prev(dlli_t *iter) {
+    if (!iter) {
+        error("dlli_has_prev", "iterator is null");
+        return false;
+    }
+    if (iter->list->ring) {
+        return iter->pos == -1 ? iter->list->size > 0 : iter->pos > 0;
+    }
+    if (_dll_prev(iter->list, iter->curr) != iter->list->end) {
+        return true;
+    }
+    return false;
+}
+
+void *dlli_next(dlli_t *iter) {
+    if (!iter) {
+        error("dlli_next", "iterator is null");
+        return false;
+    }
+    if (iter->list->ring) {
+        if (iter->pos + 1 >= iter->list->size) return NULL;
+        iter->pos++;
+        return _dll_ring_user_data(iter->list, _dll_ring_at(iter->list, iter->pos));
+    }
+    dll_node_t *next = _dll_next(iter->list, iter->curr);
+    if (next != iter->list->end) {
+        iter->curr = next;
+        if (iter->list->op_mode == REFERENCE) {
+            return *(void **)iter->curr->data;
+        } else {
+            return iter->curr->data;
+        }
+    }
+    return NULL;
+}
+
+void *dlli_prev(dlli_t *iter) {
+    if (!iter) {
+        error("dlli_prev", "iterator is null");
+        return false;
+    }
+    if (iter->list->ring) {
+        if (!dlli_has_prev(iter)) return NULL;
+        iter->pos = (iter->pos == -1 ? iter->list->size : iter->pos) - 1;
+        return _dll_ring_user_data(iter->list, _dll_ring_at(iter->list, iter->pos));
+    }
+    dll_node_t *prev = _dll_prev(iter->list, iter->curr);
+    if (prev != iter->list->end) {
+        iter->curr = prev;
+        if (iter->list->op_mode == REFERENCE) {
+            return *(void **)iter->curr->data;
+        } else {
+            return iter->curr->data;
+        }
+    }
+    return NULL;
+}
+
+static void _append(dll_node_t **start, dll_node_t **stop, dll_node_t *n) {
+    n->next = NULL;
+    n->prev = NULL;
+    if (!*start) {
+        *start = n;
+        *stop = n;
+        return;
+    }
+    (*stop)->next = n;
+    n->prev = *stop;
+    *stop = n;
+}
+
+static dll_node_t *_merge(dll_node_t *l, dll_node_t *r, cmp c, op_mode m) {
+    dll_node_t *start = NULL;
+    dll_node_t *end = NULL;
+    while(l || r) {
+        dll_node_t *curr_l = l;
+        dll_node_t *curr_r = r;
+        if (l && r) {
+            int res;
+            if (m == REFERENCE) res = (*c)(*(void **)curr_l->data, *(void **)curr_r->data);
+            else res = (*c)(curr_l->data, curr_r->data);
+            if (res < 0) {
+                r = r->next;
+                _append(&start, &end, curr_r);
+            } else {
+                l = l->next;
+                _append(&start, &end, curr_l);
+            }
+        } else {
+            // one side is empty; the rest is already linked
+            dll_node_t *rest = l ? l : r;
+            if (!start) return rest;
+            end->next = rest;
+            rest->prev = end;
+            break;
+        }
+    }
+
+    return start;
+}
+
+static dll_node_t *_mergesort(dll_node_t *nodes, int size, cmp c, op_mode m) {
+    if (size < 2) return nodes;
+    int l_size = size/2;
+    int r_size = size - l_size;
+    int i = l_size;
+    dll_node_t *l = nodes;
+    dll_node_t *r = l;
+    while (i) {
+        r = r->next;
+        --i;
+    }
+    r->prev->next = NULL;
+    r->prev = NULL;
+    l = _mergesort(l, l_size, c, m);
+    r = _mergesort(r, r_size, c, m);
+
+    return _merge(l, r, c, m);
+}
+
+void dll_sort(dll_t *list, cmp c) {
+    if (!list) {
+        error("dll_sort", "list is null");
+        return;
+    }
+    if (list->ring) {
+        if (list->size > 1 && _dll_unshare(list)) _dll_ring_sort(list, c);
+        return;
+    }
+    if (list->size == 0) return;
+    if (!_dll_unshare(list) || !_dll_materialize(list)) return;
+
+    dll_node_t *nodes = list->end->next;
+    list->end->next->prev = NULL;
+    list->end->prev->next = NULL;
+    
+    nodes = _mergesort(nodes, list->size, c, list->op_mode);
+    list->finger = NULL;
+
+    list->end->next = nodes;
+    nodes->prev = list->end;
+    while(nodes->next) nodes = nodes->next;
+    list->end->prev = nodes;
+    nodes->next = list->end;
+}
+
+/**
+ * @brief internal function; prepares the nodes between before and after
+ * (both exclusive) for moving from src to dst
+ * slabs holding only nodes of the range move to dst; nodes sharing a slab
+ * with nodes that stay in src are replaced by nodes allocated on their own
+ *
+ * @return false if memory could not be allocated (no slab moved)
+ */
+static bool _dll_hand_over(dll_t *src, dll_t *dst, dll_node_t *before, dll_node_t *after) {
+    size_t node_size = sizeof(dll_node_t) + src->data_size;
+    for (dll_node_t *node = before->next; node != after; node = node->next) {
+        if (node->in_slab) _dll_node_slab(node)->moving++;
+    }
+    bool copied = true;
+    for (dll_node_t *node = before->next; node != after; node = node->next) {
+        dll_slab_t *slab = _dll_node_slab(node);
+        if (!slab || slab->moving == slab->used) continue;
+        dll_node_t *copy = malloc(node_size);
+        if (!copy) {
+            error("dll_splice", "Could not allocate memory");
+            copied = false;
+            break;
+        }
+        if (src->index) _dll_index_remove(src, node);
+        memcpy(copy, node, node_size);
+        copy->in_slab = 0;
+        copy->prev->next = copy;
+        copy->next->prev = copy;
+        if (src->index) _dll_index_add(src, copy);
+        slab->moving--;
+        _dll_delete_node(src, node, NULL); // the slab keeps other nodes
+        node = copy;
+    }
+    for (dll_node_t *node = before->next; node != after; node = node->next) {
+        dll_slab_t *slab = _dll_node_slab(node);
+        if (!slab || !slab->moving) continue;
+        slab->moving = 0;
+        if (copied) {
+            _dll_unlink_slab(src, slab);
+            _dll_link_slab(dst, slab);
+        }
+    }
+    return copied;
+}
+
+/**
+ * @brief internal function; moves the count nodes from *first to *last
+ * (logical order of src) in front of node at of dst by relinking them
+ * both lists are linked lists without snapshots; the index of dst needs
+ * room for the nodes
+ * moved nodes that share a slab with nodes staying in src are replaced by
+ * copies (see _dll_hand_over); *first and *last are updated then
+ *
+ * @return false if memory could not be allocated (nothing moved)
+ */
+static bool _dll_move(dll_t *dst, dll_node_t *at, dll_t *src, dll_node_t **first,
+    dll_node_t **last, int count) {
+    dll_node_t *before = DLL_PREV(src, *first);
+    dll_node_t *after = DLL_NEXT(src, *last);
+
+    if (src->slabs) {
+        // a list only holds nodes of its own slabs
+        bool moved = src->reversed
+            ? _dll_hand_over(src, dst, after, before)
+            : _dll_hand_over(src, dst, before, after);
+        src->finger = NULL;
+        if (!moved) return false;
+        *first = DLL_NEXT(src, before);
+        *last = DLL_PREV(src, after);
+    }
+
+    // unlink [first, last] from src
+    _dll_set_next(src, before, after);
+    _dll_set_prev(src, after, before);
+    src->size -= count;
+
+    if (src->reversed != dst->reversed) {
+        // orientation of the moved nodes has to match dst
+        dll_node_t *node = *first;
+        while (1) {
+            dll_node_t *next = DLL_NEXT(src, node);
+            dll_node_t *tmp = node->next;
+            node->next = node->prev;
+            node->prev = tmp;
+            if (node == *last) break;
+            node = next;
+        }
+    }
+
+    // link [first, last] in front of at
+    before = DLL_PREV(dst, at);
+    _dll_set_prev(dst, *first, before);
+    _dll_set_next(dst, *last, at);
+    _dll_set_next(dst, before, *first);
+    _dll_set_prev(dst, at, *last);
+    dst->size += count;
+
+    // moved nodes keep their epochs; dst goes on after the later one (see
+    // dll_snapshot)
+    if (src->epoch > dst->epoch) dst->epoch = src->epoch;
+    if (src->index || dst->index) {
+        for (dll_node_t *node = *first; ; node = DLL_NEXT(dst, node)) {
+            if (src->index) _dll_index_remove(src, node);
+            if (dst->index) _dll_index_add(dst, node);
+            if (node == *last) break;
+        }
+    }
+
+    // indices changed; drop cached positions
+    src->finger = NULL;
+    dst->finger = NULL;
+    return true;
+}
+
+// see dll.h
+void dll_splice(dll_t *dst, int pos, dll_t *src, int from, int to) {
+    if (!dst || !src) {
+        error("dll_splice", "list is null");
+        return;
+    }
+    if (dst == src) {
+        error("dll_splice", "source and destination are the same list");
+        return;
+    }
+    if (dst->op_mode != src->op_mode || dst->data_size != src->data_size) {
+        error("dll_splice", "lists have different mode or data_size");
+        return;
+    }
+    if (pos < 0) pos = dst->size + pos + 1;
+    if (pos > dst->size || pos < 0) {
+        error("dll_splice", "index out of range");
+        return;
+    }
+    if (from < 0 || from > to || to > src->size) {
+        error("dll_splice", "range out of range");
+        return;
+    }
+    if (from == to) return;
+    if (!_dll_unshare(src) || !_dll_unshare(dst)) return;
+    if (src->ring || dst->ring) {
+        // a ring list has no nodes to relink; copy the elements and take
+        // them out of src only after all of them arrived in dst
+        int count = to - from;
+        if (dst->ring && !dll_reserve(dst, count)) return;
+        for (int i = 0; i < count; ++i) {
+            if (!_dll_insert_at(dst, pos + i, dll_peek(src, from + i))) {
+                while (i-- > 0) _dll_remove_at(dst, pos, NULL);
+                return;
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            _dll_remove_at(src, from, NULL);
+        }
+        return;
+    }
+    if (!_dll_index_reserve(dst, dst->size + to - from)) return;
+    dll_node_t *first = _dll_node_at(src, from);
+    dll_node_t *last = DLL_PREV(src, _dll_node_at(src, to));
+    _dll_move(dst, _dll_node_at(dst, pos), src, &first, &last, to - from);
+}
+
+// see dll.h
+dll_t *dll_split(dll_t *list, int pos) {
+    if (!list) {
+        error("dll_split", "list is null");
+        return NULL;
+    }
+    if (pos < 0) pos = list->size + pos;
+    if (pos > list->size || pos < 0) {
+        error("dll_split", "index out of range");
+        return NULL;
+    }
+    dll_t *tail;
+    if (list->ring) {
+        tail = dll_new_ring(list->op_mode, list->data_size);
+    } else if (list->hash) {
+        tail = dll_new_indexed(list->op_mode, list->data_size, list->hash, list->equal);
+    } else {
+        tail = dll_new(list->op_mode, list->data_size);
+    }
+    if (!tail) return NULL;
+    tail->reversed = list->reversed; // nodes keep their orientation
+    dll_splice(tail, 0, list, pos, list->size);
+    return tail;
+}
+
+/**
+ * @brief internal function; index of node in list (size for the end node)
+ */
+static int _dll_pos(dll_t *list, dll_node_t *node) {
+    int pos = 0;
+    dll_node_t *curr = _dll_next(list, list->end);
+    while (curr != node && curr != list->end) {
+        curr = _dll_next(list, curr);
+        pos++;
+    }
+    return pos;
+}
+
+// see dll.h
+void dlli_splice(dlli_t *at, dlli_t *first, dlli_t *last) {
+    if (!at || !first || !last) {
+        error("dlli_splice", "iterator is null");
+        return;
+    }
+    dll_t *dst = at->list;
+    dll_t *src = first->list;
+    if (last->list != src) {
+        error("dlli_splice", "first and last belong to different lists");
+        return;
+    }
+    if (dst == src) {
+        error("dlli_splice", "source and destination are the same list");
+        return;
+    }
+    if (dst->op_mode != src->op_mode || dst->data_size != src->data_size) {
+        error("dlli_splice", "lists have different mode or data_size");
+        return;
+    }
+    if (src->ring || dst->ring) {
+        error("dlli_splice", "ring lists have no nodes; use dll_splice");
+        return;
+    }
+    if (first->curr == src->end || last->curr == src->end) {
+        error("dlli_splice", "iterator is not on an element");
+        return;
+    }
+    // count the moved nodes (the sizes have to stay right)
+    int count = 1;
+    for (dll_node_t *node = first->curr; node != last->curr; count++) {
+        node = _dll_next(src, node);
+        if (node == src->end) {
+            error("dlli_splice", "last is before first");
+            return;
+        }
+    }
+    if (src->share || dst->share) {
+        // snapshots see the nodes; find the same positions in the copies
+        int from = _dll_pos(src, first->curr);
+        int pos = _dll_pos(dst, at->curr);
+        if (!_dll_unshare(src) || !_dll_unshare(dst)) return;
+        first->curr = _dll_node_at(src, from);
+        last->curr = _dll_node_at(src, from + count - 1);
+        at->curr = pos < dst->size ? _dll_node_at(dst, pos) : dst->end;
+    }
+    if (!_dll_index_reserve(dst, dst->size + count)) return;
+    if (!_dll_move(dst, at->curr, src, &first->curr, &last->curr, count)) return;
+    first->list = dst;
+    last->list = dst;
+}
+
+/**
+ * @brief internal function; estimated bytes malloc uses for an allocation
+ * assumes a header of one size_t and 2*size_t granularity (like glibc)
+ */
+static size_t _dll_alloc_size(size_t size) {
+    size_t unit = 2 * sizeof(size_t);
+    size_t chunk = (size + sizeof(size_t) + unit - 1) / unit * unit;
+    return chunk < 2 * unit ? 2 * unit : chunk;
+}
+
+// see dll.h
+dll_memory_usage_t dll_memory_usage(dll_t *list) {
+    dll_memory_usage_t usage = {0, 0, 0, 0};
+    if (!list) {
+        error("dll_memory_usage", "list is null");
+        return usage;
+    }
+    size_t links = 2 * sizeof(dll_node_t *);
+    size_t node_size = sizeof(dll_node_t) + list->data_size;
+    size_t slot_size = _dll_slot_size(list->data_size);
+    size_t header = (sizeof(dll_slab_t) + DLL_ALIGN - 1) / DLL_ALIGN * DLL_ALIGN;
+
+    usage.payload = list->size * list->data_size;
+    usage.links = (list->size + 1) * links; // +1: end node
+    if (list->ring) {
+        usage.links = links;
+        usage.overhead = _dll_alloc_size(sizeof(*list));
+        usage.overhead += _dll_alloc_size(sizeof(*list->end)) - links;
+        usage.overhead += _dll_alloc_size(list->ring_capacity * list->data_size);
+        usage.overhead -= usage.payload;
+        usage.total = usage.payload + usage.links + usage.overhead;
+        return usage;
+    }
+
+    // payload and links of a node are counted above; the rest is overhead
+    size_t slab_nodes = 0;
+    usage.overhead = _dll_alloc_size(sizeof(*list));
+    usage.overhead += _dll_alloc_size(sizeof(*list->end)) - links;
+    dll_slab_t *slab = list->slabs;
+    while (slab) {
+        slab_nodes += slab->used;
+        usage.overhead += _dll_alloc_size(header + slab->capacity * slot_size);
+        usage.overhead -= slab->used * (list->data_size + links);
+        slab = slab->next != list->slabs ? slab->next : NULL;
+    }
+    // a list with snapshots also holds the nodes it removed (see _dll_retire)
+    size_t nodes = list->size;
+    if (list->share && !list->snapshot) {
+        nodes += list->share->removed_count - list->share->removed_head;
+        usage.overhead += (nodes - list->size) * (list->data_size + links);
+    }
+    size_t alloc_overhead = _dll_alloc_size(node_size) - list->data_size - links;
+    usage.overhead += (nodes - slab_nodes) * alloc_overhead;
+    if (list->index) {
+        usage.overhead += _dll_alloc_size(sizeof(*list->index)
+            + list->index->capacity * sizeof(list->index->entries[0]));
+    }
+
+    usage.total = usage.payload + usage.links + usage.overhead;
+    return usage;
+}
+
+// see dll.h
+void dll_compact(dll_t *list) {
+    if (!list) {
+        error("dll_compact", "list is null");
+        return;
+    }
+    if (!_dll_unshare(list)) return;
+    if (list->ring) {
+        int capacity = DLL_RING_MIN;
+        while (capacity < list->size) capacity *= 2;
+        _dll_ring_resize(list, capacity);
+        return;
+    }
+    dll_slab_t *old_slabs = list->slabs;
+    list->slabs = NULL;
+    if (!_dll_add_slabs(list, list->size, false)) {
+        list->slabs = old_slabs;
+        return;
+    }
+
+    // copy every node into the next free slot (in logical order)
+    dll_node_t *end = list->end;
+    dll_node_t *prev = end;
+    dll_node_t *node = DLL_NEXT(list, end);
+    while (node != end) {
+        dll_node_t *next = DLL_NEXT(list, node);
+        dll_node_t *slot = _dll_take_slot(list);
+        memcpy(slot->data, node->data, list->data_size);
+        slot->born = node->born;
+        slot->died = 0;
+        slot->prev = prev;
+        prev->next = slot;
+        prev = slot;
+
+        // free the old node unless it lives in an old slab
+        if (!node->in_slab) free(node);
+        node = next;
+    }
+    prev->next = end;
+    end->prev = prev;
+    list->finger = NULL;
+    list->reversed = false;
+    if (list->index) _dll_index_rebuild(list);
+    _dll_free_slabs(old_slabs);
+}
+
+/**
+ * @brief internal function; finds a node holding data equal to data
+ * uses the index if there is one; otherwise walks the nodes (in physical
+ * order) and compares with the equal function of an indexed list (a
+ * snapshot), bytes (VALUE) or pointers (REFERENCE)
+ *
+ * @return dll_node_t* node or NULL
+ */
+static dll_node_t *_dll_find_node(dll_t *list, void *data) {
+    if (list->index) return _dll_index_find(list, data);
+    dll_node_t *end = list->end;
+    dll_node_t *node = list->reversed ? _dll_prev(list, end) : _dll_next(list, end);
+    for (; node != end; node = list->reversed ? _dll_prev(list, node) : _dll_next(list, node)) {
+        if (list->equal) {
+            if ((*list->equal)(_dll_user_data(list, node), data)) return node;
+        } else if (list->op_mode == REFERENCE) {
+            if (*(void **)node->data == data) return node;
+        } else if (memcmp(node->data, data, list->data_size) == 0) { // VALUE
+            return node;
+        }
+    }
+    return NULL;
+}
+
+// see dll.h
+void *dll_find(dll_t *list, void *data) {
+    if (!list) {
+        error("dll_find", "list is null");
+        return NULL;
+    }
+    if (list->ring) {
+        int pos = _dll_ring_find(list, data);
+        return pos < 0 ? NULL : _dll_ring_user_data(list, _dll_ring_at(list, pos));
+    }
+    dll_node_t *node = _dll_find_node(list, data);
+    return node ? _dll_user_data(list, node) : NULL;
+}
+
+// see dll.h
+bool dll_contains(dll_t *list, void *data) {
+    if (!list) {
+        error("dll_contains", "list is null");
+        return false;
+    }
+    if (list->ring) return _dll_ring_find(list, data) >= 0;
+    return _dll_find_node(list, data) != NULL;
+}
+
+// see dll.h
+bool dll_remove_value(dll_t *list, void *data, void *dest) {
+    if (!list) {
+        error("dll_remove_value", "list is null");
+        return false;
+    }
+    if (list->ring) {
+        int pos = _dll_ring_find(list, data);
+        if (pos < 0) return false;
+        void *result = _dll_remove_at(list, pos, dest);
+        if (list->op_mode == REFERENCE && dest) *(void **)dest = result;
+        return true;
+    }
+    dll_node_t *node = _dll_find_node(list, data);
+    if (!node) return false;
+    if (list->share) {
+        if (!_dll_write(list)) return false;
+        node = _dll_find_node(list, data); // nodes may have been copied
+    }
+    if (!_dll_unlink(list, node)) return false;
+    list->finger = NULL;
+    if (list->op_mode == REFERENCE) {
+        void *ref = _dll_remove_node(list, node, NULL);
+        if (dest) *(void **)dest = ref;
+    } else { // VALUE
+        _dll_remove_node(list, node, dest);
+    }
+    return true;
+}
+
+/**
+ * @brief priority queue of nodes (pairing heap, see dllh_new)
+ * a node in the heap links its first child with prev and its next sibling
+ * with next; the root has no siblings
+ */
+struct _dll_heap {
+    dll_t *store; // owns the nodes (mode, data size, slabs); holds no nodes itself
+    dll_node_t *root; // first element (or NULL)
+    int size;
+    cmp c;
+};
+
+/**
+ * @brief internal function; takes all nodes out of list; dst takes over the
+ * slabs of list (the nodes must end up in dst)
+ * list must not be shared, reversed or a ring list; it is empty afterwards
+ *
+ * @return dll_node_t* first node; the nodes stay linked by next in list
+ * order and the last next is NULL
+ */
+static dll_node_t *_dll_take_nodes(dll_t *list, dll_t *dst) {
+    dll_node_t *end = list->end;
+    dll_node_t *nodes = NULL;
+    if (end->next != end) {
+        nodes = end->next;
+        end->prev->next = NULL;
+    }
+    end->next = end;
+    end->prev = end;
+    list->size = 0;
+    list->finger = NULL;
+    if (list->index) _dll_index_rebuild(list);
+    if (list == dst) return nodes;
+    while (list->slabs) {
+        dll_slab_t *slab = list->slabs;
+        _dll_unlink_slab(list, slab);
+        _dll_link_slab(dst, slab);
+    }
+    return nodes;
+}
+
+/**
+ * @brief internal function; links node at the end of list
+ * list must not be shared, reversed or a ring list; its index needs room
+ */
+static void _dll_link_back(dll_t *list, dll_node_t *node) {
+    dll_node_t *end = list->end;
+    node->born = list->epoch;
+    node->prev = end->prev;
+    node->next = end;
+    end->prev->next = node;
+    end->prev = node;
+    list->size++;
+    if (list->index) _dll_index_add(list, node);
+}
+
+/**
+ * @brief internal function; melds two heaps (roots without siblings)
+ * like in _merge, r comes first only if c(l, r) < 0
+ *
+ * @return dll_node_t* root of the melded heap
+ */
+static dll_node_t *_dllh_meld(dllh_t *heap, dll_node_t *l, dll_node_t *r) {
+    if (!l) return r;
+    if (!r) return l;
+    if ((*heap->c)(_dll_user_data(heap->store, l), _dll_user_data(heap->store, r)) < 0) {
+        dll_node_t *tmp = l;
+        l = r;
+        r = tmp;
+    }
+    r->next = l->prev;
+    l->prev = r;
+    return l;
+}
+
+/**
+ * @brief internal function; removes the root from the heap (two-pass
+ * pairing of its children, without recursion)
+ *
+ * @return dll_node_t* former root (links set to NULL)
+ */
+static dll_node_t *_dllh_pop_node(dllh_t *heap) {
+    dll_node_t *root = heap->root;
+    dll_node_t *child = root->prev;
+    // first pass: meld pairs from left to right; the pairs are collected
+    // in reverse order (linked by next)
+    dll_node_t *pairs = NULL;
+    while (child) {
+        dll_node_t *second = child->next;
+        dll_node_t *rest = second ? second->next : NULL;
+        child->next = NULL;
+        if (second) second->next = NULL;
+        dll_node_t *pair = _dllh_meld(heap, child, second);
+        pair->next = pairs;
+        pairs = pair;
+        child = rest;
     }
-    if (list->op_mode == REFERENCE) {
-        return *(void **)node->data;
-    } else {
-        return node->data;
+    // second pass: meld the pairs from right to left
+    dll_node_t *result = NULL;
+    while (pairs) {
+        dll_node_t *next = pairs->next;
+        pairs->next = NULL;
+        result = _dllh_meld(heap, pairs, result);
+        pairs = next;
     }
+    heap->root = result;
+    heap->size--;
+    root->prev = NULL;
+    root->next = NULL;
+    return root;
 }
 
-static void *_dll_peek_from_begin(dll_t *list, int pos) {
-    if(!list) {
-        error("dll_peek", "list is null");
+// see dll.h
+dllh_t *dllh_new(op_mode mode, size_t data_size, cmp c) {
+    if (!c) {
+        error("dllh_new", "compare function is null");
         return NULL;
     }
-    if(pos >= list->size || pos < 0) {
-        error("dll_peek", "index out of range");
+    dllh_t *heap = malloc(sizeof(*heap));
+    if (!heap) {
+        error("dllh_new", "Could not allocate enough memory");
         return NULL;
     }
-    dll_node_t *end = list->end;
-    dll_node_t *node = end->next;
-    while (pos) {
-        node = node->next;
-        --pos;
-    }
-    if (list->op_mode == REFERENCE) {
-        return *(void **)node->data;
-    } else {
-        return node->data;
+    heap->store = dll_new(mode, data_size);
+    if (!heap->store) {
+        free(heap);
+        return NULL;
     }
+    heap->root = NULL;
+    heap->size = 0;
+    heap->c = c;
+    return heap;
 }
 
 // see dll.h
-void *dll_peek(dll_t *list, int pos) {
-    if (pos < 0) {
-        return _dll_peek_from_end(list, -pos-1);
-    } else {
-        return _dll_peek_from_begin(list, pos);
+void dllh_delete(dllh_t *heap, delete_data_fun func) {
+    if (!heap) return;
+    // walk the tree: a node's children are put in front of the other nodes
+    dll_node_t *todo = heap->root;
+    while (todo) {
+        dll_node_t *node = todo;
+        todo = node->next;
+        dll_node_t *child = node->prev;
+        if (child) {
+            dll_node_t *last = child;
+            while (last->next) last = last->next;
+            last->next = todo;
+            todo = child;
+        }
+        _dll_delete_node(heap->store, node, func);
     }
+    dll_delete(heap->store, NULL);
+    free(heap);
 }
 
 // see dll.h
-void dll_reverse(dll_t *list) {
-    if (!list) {
-        error("dll_reverse", "list is null");
+void dllh_push(dllh_t *heap, void *data) {
+    if (!heap) {
+        error("dllh_push", "heap is null");
         return;
     }
-    dll_node_t *node = list->end;
-    dll_node_t *tmp;
-    dll_node_t *end = list->end;
-    do {
-        tmp = node->next;
-        node->next = node->prev;
-        node->prev = tmp;
-        node = tmp;
-    } while(node != end);
+    dll_node_t *node = _dll_new_node(heap->store, data);
+    if (!node) return;
+    heap->root = _dllh_meld(heap, heap->root, node);
+    heap->size++;
 }
 
-//see dll.h
-void dll_clear(dll_t *list) {
-    if (!list) {
-        error("dll_reverse", "list is null");
-        return;
+// see dll.h
+void *dllh_peek(dllh_t *heap) {
+    if (!heap) {
+        error("dllh_peek", "heap is null");
+        return NULL;
     }
-    while (list->size > 0) {
-        _dll_remove_from_begin(list, 0, NULL);
+    if (!heap->root) return NULL;
+    return _dll_user_data(heap->store, heap->root);
+}
+
+// see dll.h
+void *dllh_pop(dllh_t *heap, void *dest) {
+    if (!heap) {
+        error("dllh_pop", "heap is null");
+        return NULL;
+    }
+    if (!heap->root) {
+        error("dllh_pop", "heap is empty");
+        return NULL;
     }
+    return _dll_remove_node(heap->store, _dllh_pop_node(heap), dest);
 }
 
-void dll_foreach(dll_t *list, foreach_fun func, void *usr) {
-    if(!list || !func) {
-        error("dll_foreach", "list or function is null");
+// see dll.h
+int dllh_size(dllh_t *heap) {
+    if (!heap) {
+        error("dllh_size", "heap is null");
+        return -1;
+    }
+    return heap->size;
+}
+
+// see dll.h
+void dllh_push_list(dllh_t *heap, dll_t *list) {
+    if (!heap || !list) {
+        error("dllh_push_list", "heap or list is null");
         return;
     }
-    dll_node_t *node = list->end->next;
-    dll_node_t *end = list->end;
-    op_mode mode = list->op_mode;
-    int i = 0;
-    while(node != end) {
-        if (mode == REFERENCE) {
-            (*func)(i, *(void **)node->data, usr);
-        } else { // VALUE
-            (*func)(i, node->data, usr);
+    dll_t *store = heap->store;
+    if (store->op_mode != list->op_mode || store->data_size != list->data_size) {
+        error("dllh_push_list", "heap and list have different mode or data_size");
+        return;
+    }
+    if (list->ring) {
+        // no nodes to take over; copy the elements (an element leaves list
+        // only after it arrived in the heap)
+        while (list->size > 0) {
+            int size = heap->size;
+            dllh_push(heap, dll_peek(list, 0));
+            if (heap->size == size) return;
+            _dll_remove_at(list, 0, NULL);
         }
-        ++i;
-        node = node->next;
+        return;
+    }
+    if (!_dll_materialize(list) || !_dll_unshare(list)) return;
+    dll_node_t *node = _dll_take_nodes(list, store);
+    while (node) {
+        dll_node_t *next = node->next;
+        node->prev = NULL;
+        node->next = NULL;
+        heap->root = _dllh_meld(heap, heap->root, node);
+        heap->size++;
+        node = next;
     }
 }
 
-dlli_t *dll_iter(dll_t *list) {
-    if (!list) {
-        error("dll_iterator", "list is null");
-        return false;
+// see dll.h
+void dllh_drain(dllh_t *heap, dll_t *list) {
+    if (!heap || !list) {
+        error("dllh_drain", "heap or list is null");
+        return;
     }
-    dlli_t *iter = malloc(sizeof(*iter));
-    if (!iter) {
-        error("dll_iterator","Could not allocate enough memory");
-        return NULL;
+    dll_t *store = heap->store;
+    if (store->op_mode != list->op_mode || store->data_size != list->data_size) {
+        error("dllh_drain", "heap and list have different mode or data_size");
+        return;
     }
-    iter->list = list;
-    iter->curr = list->end;
-    return iter;
+    if (list->ring) {
+        // no nodes to take over; copy the elements
+        while (heap->root) {
+            dll_node_t *node = _dllh_pop_node(heap);
+            if (!_dll_insert_at(list, list->size, _dll_user_data(store, node))) {
+                // keep the element in the heap
+                heap->root = _dllh_meld(heap, heap->root, node);
+                heap->size++;
+                return;
+            }
+            _dll_delete_node(store, node, NULL);
+        }
+        return;
+    }
+    if (!_dll_materialize(list) || !_dll_unshare(list)) return;
+    if (!_dll_index_reserve(list, list->size + heap->size)) return;
+    _dll_take_nodes(store, list); // store holds no nodes; only moves the slabs
+    list->finger = NULL;
+    while (heap->root) _dll_link_back(list, _dllh_pop_node(heap));
 }
 
-void dlli_delete(dlli_t *iter) {
-    free(iter);
+/**
+ * @brief internal function; head of a list in dll_kway_merge
+ */
+typedef struct dll_kway_head {
+    dll_node_t *node;
+    int list; // index in lists (earlier lists win ties)
+} dll_kway_head_t;
+
+/**
+ * @brief internal function; checks if head x comes before head y
+ * (stable like _merge: the earlier list is the left run)
+ */
+static bool _dll_kway_before(dll_t *list, cmp c, dll_kway_head_t *x, dll_kway_head_t *y) {
+    void *dx = _dll_user_data(list, x->node);
+    void *dy = _dll_user_data(list, y->node);
+    if (x->list < y->list) return (*c)(dx, dy) >= 0;
+    return (*c)(dy, dx) < 0;
 }
 
-bool dlli_has_next(dlli_t *iter) {
-    if (!iter) {
-        error("dlli_has_next", "iterator is null");
-        return false;
-    }
-    if (iter->curr->next != iter->list->end) {
-        return true;
+/**
+ * @brief internal function; moves heads[i] down the binary heap heads
+ */
+static void _dll_kway_sift(dll_t *list, cmp c, dll_kway_head_t *heads, int n, int i) {
+    while (1) {
+        int first = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && _dll_kway_before(list, c, &heads[l], &heads[first])) first = l;
+        if (r < n && _dll_kway_before(list, c, &heads[r], &heads[first])) first = r;
+        if (first == i) return;
+        dll_kway_head_t tmp = heads[i];
+        heads[i] = heads[first];
+        heads[first] = tmp;
+        i = first;
     }
-    return false;
 }
 
-bool dlli_has_prev(dlli_t *iter) {
-    if (!iter) {
-        error("dlli_has_prev", "iterator is null");
-        return false;
+// see dll.h
+void dll_kway_merge(dll_t **lists, int k, cmp c) {
+    if (!lists || k < 1 || !c) {
+        error("dll_kway_merge", "lists or compare function is null");
+        return;
     }
-    if (iter->curr->prev != iter->list->end) {
-        return true;
+    dll_t *dst = lists[0];
+    bool ring = false;
+    for (int i = 0; i < k; ++i) {
+        if (!lists[i]) {
+            error("dll_kway_merge", "list is null");
+            return;
+        }
+        if (lists[i]->op_mode != dst->op_mode || lists[i]->data_size != dst->data_size) {
+            error("dll_kway_merge", "lists have different mode or data_size");
+            return;
+        }
+        ring = ring || lists[i]->ring;
     }
-    return false;
+    if (ring) {
+        // ring lists have no nodes to relink; append and sort (stable)
+        for (int i = 1; i < k; ++i) {
+            dll_splice(dst, dst->size, lists[i], 0, lists[i]->size);
+        }
+        dll_sort(dst, c);
+        return;
+    }
+    int total = 0;
+    for (int i = 0; i < k; ++i) {
+        if (!_dll_materialize(lists[i]) || !_dll_unshare(lists[i])) return;
+        total += lists[i]->size;
+    }
+    if (!_dll_index_reserve(dst, total)) return;
+    dll_kway_head_t *heads = malloc(k * sizeof(*heads));
+    if (!heads) {
+        error("dll_kway_merge", "Could not allocate memory");
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < k; ++i) {
+        dll_node_t *nodes = _dll_take_nodes(lists[i], dst);
+        if (!nodes) continue;
+        heads[n].node = nodes;
+        heads[n].list = i;
+        n++;
+    }
+    for (int i = n / 2 - 1; i >= 0; --i) _dll_kway_sift(dst, c, heads, n, i);
+    while (n > 0) {
+        dll_node_t *node = heads[0].node;
+        dll_node_t *next = node->next;
+        _dll_link_back(dst, node);
+        if (next) heads[0].node = next;
+        else heads[0] = heads[--n];
+        _dll_kway_sift(dst, c, heads, n, 0);
+    }
+    free(heads);
 }
 
-void *dlli_next(dlli_t *iter) {
-    if (!iter) {
-        error("dlli_next", "iterator is null");
+/**
+ * @brief internal function; checks the index of list (see dll_validate)
+ * every node is in the index at a slot its probe sequence reaches
+ */
+static bool _dll_validate_index(dll_t *list) {
+    dll_index_t *index = list->index;
+    size_t mask = index->capacity - 1;
+    if (index->count != (size_t)list->size || index->count * 2 > index->capacity) {
+        error("dll_validate", "index count does not match");
         return false;
     }
-    if (iter->curr->next != iter->list->end) {
-        iter->curr = iter->curr->next;
-        if (iter->list->op_mode == REFERENCE) {
-            return *(void **)iter->curr->data;
-        } else {
-            return iter->curr->data;
+    size_t entries = 0;
+    for (size_t i = 0; i < index->capacity; ++i) {
+        dll_node_t *node = index->entries[i].node;
+        if (!node) continue;
+        entries++;
+        size_t hash = (*list->hash)(_dll_user_data(list, node));
+        if (index->entries[i].hash != hash) {
+            error("dll_validate", "index entry has wrong hash");
+            return false;
+        }
+        for (size_t j = hash & mask; j != i; j = (j + 1) & mask) {
+            if (!index->entries[j].node) {
+                error("dll_validate", "index entry is not reachable");
+                return false;
+            }
         }
     }
-    return NULL;
-}
-
-void *dlli_prev(dlli_t *iter) {
-    if (!iter) {
-        error("dlli_prev", "iterator is null");
+    if (entries != index->count) {
+        error("dll_validate", "index count does not match");
         return false;
     }
-    if (iter->curr->prev != iter->list->end) {
-        iter->curr = iter->curr->prev;
-        if (iter->list->op_mode == REFERENCE) {
-            return *(void **)iter->curr->data;
-        } else {
-            return iter->curr->data;
+    for (dll_node_t *node = _dll_next(list, list->end); node != list->end;
+        node = _dll_next(list, node)) {
+        size_t i = (*list->hash)(_dll_user_data(list, node)) & mask;
+        while (index->entries[i].node && index->entries[i].node != node) {
+            i = (i + 1) & mask;
+        }
+        if (!index->entries[i].node) {
+            error("dll_validate", "node is missing in index");
+            return false;
         }
     }
-    return NULL;
+    return true;
 }
 
-static void _debug_print(dll_node_t *node) {
-    printf("{ ");
-    while (node) {
-        printf("%d ", *(int *)node->data);
-        node = node->next;
-    }
-    printf("}\n");
+/**
+ * @brief internal function; counts node in its slab (see _dll_validate_slabs)
+ *
+ * @return error message or NULL
+ */
+static char *_dll_count_slot(dll_node_t *node) {
+    dll_slab_t *slab = _dll_node_slab(node);
+    if (!slab) return NULL;
+    if (slab->moving < 1) return "node is in a slab of another list";
+    slab->moving++;
+    return NULL;
 }
 
-static void _append(dll_node_t **start, dll_node_t **stop, dll_node_t *n) {
-    n->next = NULL;
-    n->prev = NULL;
-    if (!*start) {
-        *start = n;
-        *stop = n;
-        return;
+/**
+ * @brief internal function; checks the slabs of list (see dll_validate)
+ * each slot is either a node of the list or a free slot; every node in a
+ * slab uses a slab of list; slabs with free slots come first
+ */
+static bool _dll_validate_slabs(dll_t *list) {
+    char *msg = NULL;
+    size_t slot_size = _dll_slot_size(list->data_size);
+    bool full_seen = false;
+    dll_slab_t *slab = list->slabs;
+    // moving counts the nodes of the slab plus one (0: not a slab of list)
+    while (slab && !msg) {
+        if (slab->next->prev != slab || slab->moving != 0) {
+            msg = "broken ring of slabs";
+        } else if (full_seen && slab->free_slots) {
+            msg = "slab with free slots behind a full slab";
+        }
+        full_seen = full_seen || !slab->free_slots;
+        slab->moving = 1;
+        slab = slab->next != list->slabs ? slab->next : NULL;
     }
-    (*stop)->next = n;
-    n->prev = *stop;
-    *stop = n;
-}
-
-static dll_node_t *_merge(dll_node_t *l, dll_node_t *r, cmp c, op_mode m) {
-    dll_node_t *start = NULL;
-    dll_node_t *end = NULL;
-    while(l || r) {
-        dll_node_t *curr_l = l;
-        dll_node_t *curr_r = r;
-        if (l && r) {
-            int res;
-            if (m == REFERENCE) res = (*c)(*(void **)curr_l->data, *(void **)curr_r->data);
-            else res = (*c)(curr_l->data, curr_r->data);
-            if (res < 0) {
-                r = r->next;
-                _append(&start, &end, curr_r);
-            } else {
-                l = l->next;
-                _append(&start, &end, curr_l);
+    for (dll_node_t *node = list->end->next; node != list->end && !msg; node = node->next) {
+        msg = _dll_count_slot(node);
+    }
+    // unlinked removed nodes (see _dll_reclaim) still hold their slots
+    dll_share_t *share = list->share;
+    for (int i = share ? share->removed_head : 0; share && i < share->removed_linked && !msg; ++i) {
+        msg = _dll_count_slot(share->removed[i].node);
+    }
+    for (slab = list->slabs; slab; slab = slab->next != list->slabs ? slab->next : NULL) {
+        int unused = 0;
+        unsigned char *slots = _dll_slab_slots(slab);
+        for (dll_node_t *node = slab->free_slots; node && !msg; node = node->next) {
+            unsigned char *addr = (unsigned char *)node;
+            if (_dll_node_slab(node) != slab || addr < slots
+                || addr >= slots + slab->capacity * slot_size) {
+                msg = "free slot is not in its slab";
             }
-        } else if (l) {
-            l = l->next;
-            _append(&start, &end, curr_l);
-        } else if (r) {
-            r = r->next;
-            _append(&start, &end, curr_r);
+            unused++;
+        }
+        if (!msg && (slab->moving - 1 != slab->used || slab->used + unused != slab->capacity)) {
+            msg = "slab counters do not match";
         }
+        if (!msg && slab->used == 0 && !slab->reserved) {
+            msg = "empty slab was not freed";
+        }
+        slab->moving = 0;
     }
-
-    _debug_print(start);
-    return start;
+    if (msg) {
+        error("dll_validate", msg);
+        return false;
+    }
+    return true;
 }
 
-static dll_node_t *_mergesort(dll_node_t *nodes, int size, cmp c, op_mode m) {
-    //_debug_print(nodes);
-    if (size < 2) return nodes;
-    int l_size = size/2;
-    int r_size = size - l_size;
-    int i = l_size;
-    dll_node_t *l = nodes;
-    dll_node_t *r = l;
-    while (i) {
-        r = r->next;
-        --i;
+/**
+ * @brief internal function; checks the nodes a list with snapshots removed
+ * (see dll_validate): the linked ones are the nodes marked as removed;
+ * no epoch is later than the one of the list; the cached first and last
+ * node are the ones the list sees
+ */
+static bool _dll_validate_removed(dll_t *list) {
+    dll_share_t *share = list->share;
+    char *msg = NULL;
+    int dead = 0;
+    dll_node_t *first = list->end; // physical order
+    dll_node_t *last = list->end;
+    for (dll_node_t *node = list->end->next; node != list->end && !msg; node = node->next) {
+        if (node->next->prev != node) msg = "broken links";
+        else if (node->born > list->epoch || node->died > list->epoch) {
+            msg = "node has a later epoch than the list";
+        }
+        if (node->died) dead++;
+        else if (first == list->end) first = node;
+        if (!node->died) last = node;
     }
-    r->prev->next = NULL;
-    r->prev = NULL;
-    l = _mergesort(l, l_size, c, m);
-    r = _mergesort(r, r_size, c, m);
-
-    return _merge(l, r, c, m);
+    if (!msg && ((list->live_first && list->live_first != first)
+        || (list->live_last && list->live_last != last))) {
+        msg = "cached first or last node is wrong";
+    }
+    if (!msg && (share->removed_head > share->removed_linked
+        || share->removed_linked > share->removed_count
+        || share->removed_count > share->removed_capacity)) {
+        msg = "removed nodes out of range";
+    }
+    if (!msg && dead != share->removed_count - share->removed_linked) {
+        msg = "removed nodes do not match";
+    }
+    for (int i = share->removed_head; i < share->removed_count && !msg; ++i) {
+        if (!share->removed[i].node->died) msg = "removed node is not marked";
+    }
+    for (dll_epoch_t *record = share->oldest; record && !msg; record = record->next) {
+        if (record->epoch > list->epoch || (record->next && record->next->epoch <= record->epoch)) {
+            msg = "snapshot epochs out of order";
+        }
+    }
+    if (msg) {
+        error("dll_validate", msg);
+        return false;
+    }
+    return true;
 }
 
-void dll_sort(dll_t *list, cmp c) {
+// see dll.h
+bool dll_validate(dll_t *list) {
     if (!list) {
-        error("dll_sort", "list is null");
-        return;
+        error("dll_validate", "list is null");
+        return false;
     }
-    if (list->end->next == list->end) return;
-
-    dll_node_t *nodes = list->end->next;
-    list->end->next->prev = NULL;
-    list->end->prev->next = NULL;
-    
-    nodes = _mergesort(nodes, list->size, c, list->op_mode);
-
-    list->end->next = nodes;
-    nodes->prev = list->end;
-    while(nodes->next) nodes = nodes->next;
-    list->end->prev = nodes;
-    nodes->next = list->end;
+    if (list->size < 0) {
+        error("dll_validate", "negative size");
+        return false;
+    }
+    if (list->share && DLL_ATOMIC_LOAD(&list->share->refs) < 1) {
+        error("dll_validate", "share has no users");
+        return false;
+    }
+    if (list->ring) {
+        int capacity = list->ring_capacity;
+        if (capacity < 1 || (capacity & (capacity - 1)) || capacity < list->size
+            || list->ring_head < 0 || list->ring_head >= capacity) {
+            error("dll_validate", "ring capacity or head out of range");
+            return false;
+        }
+        if (list->end->next != list->end || list->index || list->slabs) {
+            error("dll_validate", "ring list has nodes");
+            return false;
+        }
+        return true;
+    }
+    dll_node_t *end = list->end;
+    ssize_t count = 0;
+    bool finger_found = !list->finger;
+    dll_node_t *node = _dll_next(list, end);
+    for (; node != end && count <= list->size; node = _dll_next(list, node)) {
+        if (!node->next || !node->prev || node->next->prev != node
+            || node->prev->next != node) {
+            error("dll_validate", "broken links");
+            return false;
+        }
+        if (!list->snapshot && node->born > list->epoch) {
+            error("dll_validate", "node has a later epoch than the list");
+            return false;
+        }
+        if (node == list->finger) {
+            finger_found = list->finger_pos == count;
+        }
+        count++;
+    }
+    if (count != list->size || end->next->prev != end || end->prev->next != end) {
+        error("dll_validate", "size does not match nodes");
+        return false;
+    }
+    if (!finger_found) {
+        error("dll_validate", "finger is not at its index");
+        return false;
+    }
+    if (list->snapshot) {
+        if (list->index || list->slabs) {
+            error("dll_validate", "snapshot owns an index or slabs");
+            return false;
+        }
+        return true; // the writer owns the nodes
+    }
+    if (list->share && !_dll_validate_removed(list)) return false;
+    if (list->index && !_dll_validate_index(list)) return false;
+    return _dll_validate_slabs(list);
 }
@@ -0,0 +1,276 @@
+#define _POSIX_C_SOURCE 200809L // pthread, clock_gettime
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "dllq.h"
+
+struct _dll_queue {
+    dll_t *list; // elements (slots reserved for capacity elements)
+    op_mode op_mode;
+    size_t elem_size; // bytes per element in pop destinations
+    int capacity; // maximum number of elements
+    bool closed; // no more pushes
+
+    int waiting_producers; // threads blocked in a push
+    int waiting_consumers; // threads blocked in a pop
+
+    pthread_mutex_t lock; // protects everything above
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+};
+
+/**
+ * @brief prints an error and details; useful to print error messages
+ *
+ * @param location name of the caller function
+ * @param msg description of the error
+ */
+static void error(char *location, char *msg) {
+    fprintf(stderr, "Error [%s] : %s.\n", location, msg);
+}
+
+// see dllq.h
+dllq_t *dllq_new(op_mode mode, size_t data_size, int capacity) {
+    if (capacity <= 0) {
+        error("dllq_new", "capacity needs to be larger than 0");
+        return NULL;
+    }
+    dllq_t *queue = malloc(sizeof(*queue));
+    if (!queue) {
+        error("dllq_new", "Could not allocate enough memory");
+        return NULL;
+    }
+    queue->list = dll_new(mode, data_size);
+    if (!queue->list) {
+        free(queue);
+        return NULL;
+    }
+    if (!dll_reserve(queue->list, capacity)) {
+        // pushes would allocate (and could fail) under the lock
+        dll_delete(queue->list, NULL);
+        free(queue);
+        return NULL;
+    }
+    queue->op_mode = mode;
+    queue->elem_size = mode == REFERENCE ? sizeof(void *) : data_size;
+    queue->capacity = capacity;
+    queue->closed = false;
+    queue->waiting_producers = 0;
+    queue->waiting_consumers = 0;
+    if (pthread_mutex_init(&queue->lock, NULL) != 0) {
+        error("dllq_new", "Could not create mutex");
+        dll_delete(queue->list, NULL);
+        free(queue);
+        return NULL;
+    }
+    if (pthread_cond_init(&queue->not_full, NULL) != 0) {
+        error("dllq_new", "Could not create condition variable");
+        pthread_mutex_destroy(&queue->lock);
+        dll_delete(queue->list, NULL);
+        free(queue);
+        return NULL;
+    }
+    if (pthread_cond_init(&queue->not_empty, NULL) != 0) {
+        error("dllq_new", "Could not create condition variable");
+        pthread_cond_destroy(&queue->not_full);
+        pthread_mutex_destroy(&queue->lock);
+        dll_delete(queue->list, NULL);
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+// see dllq.h
+void dllq_delete(dllq_t *queue, delete_data_fun func) {
+    if (!queue) return;
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_mutex_destroy(&queue->lock);
+    dll_delete(queue->list, func);
+    free(queue);
+}
+
+// see dllq.h
+void dllq_close(dllq_t *queue) {
+    if (!queue) {
+        error("dllq_close", "queue is null");
+        return;
+    }
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * @brief internal function; computes the absolute time in timeout_ms
+ */
+static void _dllq_deadline(long timeout_ms, struct timespec *deadline) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief internal function; waits on cond (lock is held)
+ *
+ * @param deadline absolute time or NULL (wait without limit)
+ * @return false if the deadline passed
+ */
+static bool _dllq_wait(pthread_cond_t *cond, pthread_mutex_t *lock, struct timespec *deadline) {
+    if (!deadline) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) == 0;
+}
+
+/**
+ * @brief internal function; appends data
+ *
+ * @param block false: return at once if full
+ * @param deadline absolute time to give up or NULL
+ * @return true if data was appended
+ */
+static bool _dllq_push(dllq_t *queue, void *data, bool block, struct timespec *deadline) {
+    pthread_mutex_lock(&queue->lock);
+    while (block && !queue->closed && dll_size(queue->list) >= queue->capacity) {
+        queue->waiting_producers++;
+        bool woken = _dllq_wait(&queue->not_full, &queue->lock, deadline);
+        queue->waiting_producers--;
+        if (!woken) break;
+    }
+    bool pushed = !queue->closed && dll_size(queue->list) < queue->capacity;
+    if (pushed) {
+        dll_push_back(queue->list, data);
+        if (queue->waiting_consumers) pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+/**
+ * @brief internal function; removes up to max elements into dest
+ *
+ * @param block false: return at once if empty
+ * @param deadline absolute time to give up or NULL
+ * @return int number of removed elements
+ */
+static int _dllq_pop(dllq_t *queue, void *dest, int max, bool block, struct timespec *deadline) {
+    pthread_mutex_lock(&queue->lock);
+    while (block && !queue->closed && dll_size(queue->list) == 0) {
+        queue->waiting_consumers++;
+        bool woken = _dllq_wait(&queue->not_empty, &queue->lock, deadline);
+        queue->waiting_consumers--;
+        if (!woken) break;
+    }
+    unsigned char *out = dest;
+    int count = 0;
+    while (count < max && dll_size(queue->list) > 0) {
+        void *slot = out ? out + count * queue->elem_size : NULL;
+        if (queue->op_mode == REFERENCE) {
+            void *ref = dll_pop_front(queue->list, NULL);
+            if (slot) *(void **)slot = ref;
+        } else { // VALUE
+            dll_pop_front(queue->list, slot);
+        }
+        ++count;
+    }
+    if (count > 0 && queue->waiting_producers) {
+        if (count == 1) pthread_cond_signal(&queue->not_full);
+        else pthread_cond_broadcast(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+// see dllq.h
+bool dllq_push(dllq_t *queue, void *data) {
+    if (!queue) {
+        error("dllq_push", "queue is null");
+        return false;
+    }
+    return _dllq_push(queue, data, true, NULL);
+}
+
+// see dllq.h
+bool dllq_try_push(dllq_t *queue, void *data) {
+    if (!queue) {
+        error("dllq_try_push", "queue is null");
+        return false;
+    }
+    return _dllq_push(queue, data, false, NULL);
+}
+
+// see dllq.h
+bool dllq_timed_push(dllq_t *queue, void *data, long timeout_ms) {
+    if (!queue) {
+        error("dllq_timed_push", "queue is null");
+        return false;
+    }
+    struct timespec deadline;
+    _dllq_deadline(timeout_ms, &deadline);
+    return _dllq_push(queue, data, true, &deadline);
+}
+
+// see dllq.h
+bool dllq_pop(dllq_t *queue, void *dest) {
+    if (!queue) {
+        error("dllq_pop", "queue is null");
+        return false;
+    }
+    return _dllq_pop(queue, dest, 1, true, NULL) == 1;
+}
+
+// see dllq.h
+bool dllq_try_pop(dllq_t *queue, void *dest) {
+    if (!queue) {
+        error("dllq_try_pop", "queue is null");
+        return false;
+    }
+    return _dllq_pop(queue, dest, 1, false, NULL) == 1;
+}
+
+// see dllq.h
+bool dllq_timed_pop(dllq_t *queue, void *dest, long timeout_ms) {
+    if (!queue) {
+        error("dllq_timed_pop", "queue is null");
+        return false;
+    }
+    struct timespec deadline;
+    _dllq_deadline(timeout_ms, &deadline);
+    return _dllq_pop(queue, dest, 1, true, &deadline) == 1;
+}
+
+// see dllq.h
+int dllq_pop_batch(dllq_t *queue, void *dest, int max) {
+    if (!queue || !dest) {
+        error("dllq_pop_batch", "queue or dest is null");
+        return -1;
+    }
+    if (max < 1) {
+        // 0 would read as "closed and empty"
+        error("dllq_pop_batch", "max needs to be larger than 0");
+        return -1;
+    }
+    return _dllq_pop(queue, dest, max, true, NULL);
+}
+
+// see dllq.h
+int dllq_size(dllq_t *queue) {
+    if (!queue) {
+        error("dllq_size", "queue is null");
+        return -1;
+    }
+    pthread_mutex_lock(&queue->lock);
+    int size = dll_size(queue->list);
+    pthread_mutex_unlock(&queue->lock);
+    return size;
+}
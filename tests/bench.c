@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "dll.h"
+
+// scan benchmark; use a list much larger than the last level cache
+// also times queue traffic while a snapshot is alive
+// usage: bin/bench [number of nodes]
+
+typedef struct item {
+    int key;
+    int value;
+} item;
+
+void sum_value(int index, void *data, void *acc) {
+    *(long *)acc += ((item *)data)->value;
+}
+
+int key_cmp(void *dl, void *dr) {
+    return ((item *)dl)->key > ((item *)dr)->key ? -1 : 1;
+}
+
+/**
+ * @brief scans the list with dll_foreach and dlli_next; prints best time
+ */
+void bench_scan(char *name, dll_t *list) {
+    double best_foreach = -1;
+    double best_iter = -1;
+    long sum_foreach = 0;
+    long sum_iter = 0;
+    for (int run = 0; run < 3; ++run) {
+        sum_foreach = 0;
+        clock_t start = clock();
+        dll_foreach(list, sum_value, &sum_foreach);
+        double t = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (best_foreach < 0 || t < best_foreach) best_foreach = t;
+
+        sum_iter = 0;
+        start = clock();
+        dlli_t *iter = dll_iter(list);
+        while (dlli_has_next(iter)) {
+            sum_iter += ((item *)dlli_next(iter))->value;
+        }
+        dlli_delete(iter);
+        t = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (best_iter < 0 || t < best_iter) best_iter = t;
+    }
+    double n = dll_size(list);
+    printf("%-28s foreach %7.2f ns/node  iter %7.2f ns/node  (sum %ld/%ld)\n",
+        name, best_foreach * 1e9 / n, best_iter * 1e9 / n, sum_foreach, sum_iter);
+}
+
+/**
+ * @brief pop_front + push_back pairs (queue traffic), without and with a
+ * snapshot that stays alive: removed nodes stay linked for the snapshot
+ */
+void bench_fifo(int n) {
+    int pairs = n / 4;
+    for (int with_snapshot = 0; with_snapshot < 2; ++with_snapshot) {
+        dll_t *list = dll_new(VALUE, sizeof(item));
+        for (int i = 0; i < n; ++i) {
+            item it = {i, i % 100};
+            dll_push_back(list, &it);
+        }
+        dll_t *snapshot = with_snapshot ? dll_snapshot(list) : NULL;
+        clock_t start = clock();
+        for (int i = 0; i < pairs; ++i) {
+            item it;
+            dll_pop_front(list, &it);
+            dll_push_back(list, &it);
+        }
+        double t = (double)(clock() - start) / CLOCKS_PER_SEC;
+        printf("%-28s %7.2f ns/pair\n", with_snapshot ? "fifo + live snapshot" : "fifo",
+            t * 1e9 / pairs);
+        dll_delete(list, NULL);
+        dll_delete(snapshot, NULL);
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 1 << 22;
+    srand(42);
+
+    dll_t *list = dll_new(VALUE, sizeof(item));
+    for (int i = 0; i < n; ++i) {
+        item it = {rand(), i % 100};
+        dll_push_back(list, &it);
+    }
+    bench_scan("push_back (malloc)", list);
+
+    dll_sort(list, key_cmp); // logical order no longer matches memory order
+    bench_scan("sorted (scattered)", list);
+
+    dll_compact(list);
+    bench_scan("sorted + dll_compact", list);
+    dll_delete(list, NULL);
+
+    list = dll_new(VALUE, sizeof(item));
+    dll_reserve(list, n);
+    for (int i = 0; i < n; ++i) {
+        item it = {rand(), i % 100};
+        dll_push_back(list, &it);
+    }
+    bench_scan("dll_reserve + push_back", list);
+    dll_delete(list, NULL);
+
+    bench_fifo(n);
+    return 0;
+}
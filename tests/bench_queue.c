@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L // pthread, clock_gettime
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "dll.h"
+#include "dllq.h"
+
+// producer/consumer benchmark: dllq_t vs. a mutex around a dll_t with
+// consumers polling dll_size
+// usage: bin/bench_queue [items per producer]
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define BATCH 32
+#define CAPACITY 1024
+
+typedef struct item {
+    double pushed; // time of push in ns
+} item;
+
+typedef struct bench {
+    dllq_t *queue; // used by the dllq_t variant
+    dll_t *list; // used by the mutex variant
+    pthread_mutex_t lock;
+    int items; // per producer
+    int consumed; // by all consumers (mutex variant)
+    double *latency; // one per item
+    int latency_count;
+    pthread_mutex_t latency_lock;
+} bench;
+
+double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void record(bench *b, double *latency, int count) {
+    pthread_mutex_lock(&b->latency_lock);
+    for (int i = 0; i < count; ++i) b->latency[b->latency_count++] = latency[i];
+    pthread_mutex_unlock(&b->latency_lock);
+}
+
+void *queue_producer(void *arg) {
+    bench *b = arg;
+    for (int i = 0; i < b->items; ++i) {
+        item it = {now_ns()};
+        dllq_push(b->queue, &it);
+    }
+    return NULL;
+}
+
+void *queue_consumer(void *arg) {
+    bench *b = arg;
+    item items[BATCH];
+    double latency[BATCH];
+    int count;
+    while ((count = dllq_pop_batch(b->queue, items, BATCH)) > 0) {
+        double t = now_ns();
+        for (int i = 0; i < count; ++i) latency[i] = t - items[i].pushed;
+        record(b, latency, count);
+    }
+    return NULL;
+}
+
+void *mutex_producer(void *arg) {
+    bench *b = arg;
+    for (int i = 0; i < b->items; ++i) {
+        item it = {now_ns()};
+        pthread_mutex_lock(&b->lock);
+        dll_push_back(b->list, &it);
+        pthread_mutex_unlock(&b->lock);
+    }
+    return NULL;
+}
+
+void *mutex_consumer(void *arg) {
+    bench *b = arg;
+    int total = PRODUCERS * b->items;
+    while (1) {
+        item it;
+        bool got = false;
+        bool done = false;
+        pthread_mutex_lock(&b->lock);
+        if (dll_size(b->list) > 0) {
+            dll_pop_front(b->list, &it);
+            b->consumed++;
+            got = true;
+        }
+        done = b->consumed >= total;
+        pthread_mutex_unlock(&b->lock);
+        if (got) {
+            double latency = now_ns() - it.pushed;
+            record(b, &latency, 1);
+        }
+        if (done) break;
+    }
+    return NULL;
+}
+
+int cmp_double(const void *l, const void *r) {
+    double a = *(double *)l;
+    double b = *(double *)r;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief runs producers and consumers and prints throughput and latency
+ */
+void run(char *name, bench *b, void *(*producer)(void *), void *(*consumer)(void *)) {
+    pthread_t producers[PRODUCERS];
+    pthread_t consumers[CONSUMERS];
+    b->latency_count = 0;
+    double start = now_ns();
+    for (int i = 0; i < CONSUMERS; ++i) pthread_create(&consumers[i], NULL, consumer, b);
+    for (int i = 0; i < PRODUCERS; ++i) pthread_create(&producers[i], NULL, producer, b);
+    for (int i = 0; i < PRODUCERS; ++i) pthread_join(producers[i], NULL);
+    if (b->queue) dllq_close(b->queue);
+    for (int i = 0; i < CONSUMERS; ++i) pthread_join(consumers[i], NULL);
+    double seconds = (now_ns() - start) / 1e9;
+
+    int n = b->latency_count;
+    qsort(b->latency, n, sizeof(*b->latency), cmp_double);
+    printf("%-14s %6.2f M items/s  latency p50 %8.0f ns  p99 %10.0f ns  max %10.0f ns\n",
+        name, n / seconds / 1e6, b->latency[n / 2], b->latency[n / 100 * 99], b->latency[n - 1]);
+}
+
+int main(int argc, char const *argv[]) {
+    bench b;
+    b.items = argc > 1 ? atoi(argv[1]) : 250000;
+    b.latency = malloc(sizeof(*b.latency) * PRODUCERS * b.items);
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_mutex_init(&b.latency_lock, NULL);
+
+    b.queue = NULL;
+    b.list = dll_new(VALUE, sizeof(item));
+    b.consumed = 0;
+    run("mutex + dll_t", &b, mutex_producer, mutex_consumer);
+    dll_delete(b.list, NULL);
+
+    b.list = NULL;
+    b.queue = dllq_new(VALUE, sizeof(item), CAPACITY);
+    run("dllq_t", &b, queue_producer, queue_consumer);
+    dllq_delete(b.queue, NULL);
+
+    free(b.latency);
+    return 0;
+}
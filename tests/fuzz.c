@@ -0,0 +1,914 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "dll.h"
+#include "dllq.h"
+
+// differential fuzz test: replays random operations on lists of every
+// storage mode (VALUE and REFERENCE) and on an array model; checks both
+// after every operation and prints the time per operation family; then
+// does the same for dllq_t and runs it and snapshots with several threads
+// usage: bin/fuzz [seed] [operations per mode]
+
+#define MAX_SIZE 600 // lists do not grow beyond (about) this size
+#define MAX_VALUE 1000
+#define SNAPSHOTS 4 // live snapshots of the lists at a time
+#define MAX_CAPACITY 16 // of the queues
+#define PRODUCERS 3 // threads of the threaded queue test
+#define CONSUMERS 3
+#define READERS 3 // threads of the threaded snapshot test
+
+typedef enum storage {
+    LINKED, // dll_new
+    RESERVED, // dll_new + dll_reserve
+    INDEXED, // dll_new_indexed
+    RING, // dll_new_ring
+    STORAGES
+} storage;
+
+typedef enum family {
+    INSERT, REMOVE, PUSH, POP, PEEK, REVERSE, SORT, CLEAR,
+    ITERATE, SPLICE, FIND, SNAPSHOT, COMPACT, HEAP, MERGE, FAMILIES
+} family;
+
+/**
+ * @brief reference model of a list: a plain array
+ */
+typedef struct model {
+    int data[3 * MAX_SIZE];
+    int size;
+} model;
+
+/**
+ * @brief time and number of operations per family, storage mode (of the
+ * first list) and op_mode
+ */
+typedef struct stats {
+    double seconds[FAMILIES][STORAGES][2];
+    long count[FAMILIES][STORAGES][2];
+} stats;
+
+/**
+ * @brief state of one fuzz run: two lists (for splice and merge; the
+ * second one may use another storage mode), snapshots of them and their
+ * models
+ * the lists get pointers into values (VALUE lists copy the int, REFERENCE
+ * lists store the pointer; equal values share it)
+ */
+typedef struct fuzz {
+    storage mode; // of the first list
+    storage partner; // of the second list
+    op_mode op_mode;
+    int values[MAX_VALUE];
+    dll_t *lists[2];
+    model models[2];
+    dll_t *snapshots[SNAPSHOTS]; // NULL: free slot
+    model snapshot_models[SNAPSHOTS];
+    stats *stats;
+    long op; // number of the current operation
+} fuzz;
+
+typedef struct foreach_check {
+    model *model;
+    bool ok;
+} foreach_check;
+
+const char *storage_name(storage mode) {
+    const char *names[STORAGES] = {"linked", "reserved", "indexed", "ring"};
+    return names[mode];
+}
+
+const char *family_name(family f) {
+    const char *names[FAMILIES] = {
+        "insert", "remove", "push", "pop", "peek", "reverse", "sort",
+        "clear", "iterate", "splice/split", "find", "snapshot", "compact",
+        "heap", "kway merge"
+    };
+    return names[f];
+}
+
+size_t int_hash(void *data) {
+    return (size_t)*(int *)data * 2654435761u;
+}
+
+bool int_equal(void *dl, void *dr) {
+    return *(int *)dl == *(int *)dr;
+}
+
+// ascending order (see dll_sort)
+int int_cmp(void *dl, void *dr) {
+    return *(int *)dl > *(int *)dr ? -1 : 1;
+}
+
+int int_qsort_cmp(const void *l, const void *r) {
+    return *(int *)l - *(int *)r;
+}
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief value of removed data: REFERENCE lists return the stored pointer,
+ * VALUE lists copy the data to dest (result)
+ */
+int removed_value(fuzz *fz, void *ref, int result) {
+    if (fz->op_mode == VALUE) return result;
+    return ref ? *(int *)ref : -1;
+}
+
+/**
+ * @brief adds the time since start to family f
+ */
+void add_time(fuzz *fz, family f, double start) {
+    fz->stats->seconds[f][fz->mode][fz->op_mode == REFERENCE] += now() - start;
+}
+
+void foreach_compare(int index, void *data, void *usr) {
+    foreach_check *check = usr;
+    if (index >= check->model->size || *(int *)data != check->model->data[index]) {
+        check->ok = false;
+    }
+}
+
+// model operations
+
+void model_insert(model *m, int pos, int value) {
+    memmove(m->data + pos + 1, m->data + pos, (m->size - pos) * sizeof(int));
+    m->data[pos] = value;
+    m->size++;
+}
+
+int model_remove(model *m, int pos) {
+    int value = m->data[pos];
+    memmove(m->data + pos, m->data + pos + 1, (m->size - pos - 1) * sizeof(int));
+    m->size--;
+    return value;
+}
+
+void model_reverse(model *m) {
+    for (int i = 0; i < m->size / 2; ++i) {
+        int tmp = m->data[i];
+        m->data[i] = m->data[m->size - 1 - i];
+        m->data[m->size - 1 - i] = tmp;
+    }
+}
+
+/**
+ * @brief moves [from, to) of src in front of pos of dst (like dll_splice)
+ */
+void model_splice(model *dst, int pos, model *src, int from, int to) {
+    int count = to - from;
+    memmove(dst->data + pos + count, dst->data + pos, (dst->size - pos) * sizeof(int));
+    memcpy(dst->data + pos, src->data + from, count * sizeof(int));
+    dst->size += count;
+    memmove(src->data + from, src->data + to, (src->size - to) * sizeof(int));
+    src->size -= count;
+}
+
+/**
+ * @brief compares list with its model and checks the list invariants
+ * walks the list forwards and backwards with an iterator, with
+ * dll_foreach and with dll_peek
+ *
+ * @return true if list and model are equal
+ */
+bool check(dll_t *list, model *m) {
+    if (!dll_validate(list) || dll_size(list) != m->size) return false;
+    bool ok = true;
+    dlli_t *iter = dll_iter(list);
+    int i = 0;
+    while (ok && dlli_has_next(iter)) {
+        ok = i < m->size && *(int *)dlli_next(iter) == m->data[i++];
+    }
+    dlli_delete(iter);
+    if (!ok || i != m->size) return false;
+
+    iter = dll_iter(list);
+    i = m->size;
+    while (ok && dlli_has_prev(iter)) {
+        ok = i > 0 && *(int *)dlli_prev(iter) == m->data[--i];
+    }
+    dlli_delete(iter);
+    if (!ok || i != 0) return false;
+
+    foreach_check fc = {m, true};
+    dll_foreach(list, foreach_compare, &fc);
+    if (!fc.ok) return false;
+
+    for (i = 0; i < m->size; ++i) {
+        if (*(int *)dll_peek(list, i) != m->data[i]) return false;
+    }
+    return true;
+}
+
+dll_t *new_list(storage mode, op_mode op) {
+    dll_t *list = NULL;
+    switch (mode) {
+    case LINKED:
+        list = dll_new(op, sizeof(int));
+        break;
+    case RESERVED:
+        list = dll_new(op, sizeof(int));
+        dll_reserve(list, MAX_SIZE / 2);
+        break;
+    case INDEXED:
+        list = dll_new_indexed(op, sizeof(int), int_hash, int_equal);
+        break;
+    case RING:
+        list = dll_new_ring(op, sizeof(int));
+        break;
+    default:
+        break;
+    }
+    return list;
+}
+
+/**
+ * @brief runs one random operation of family f on list k
+ *
+ * @return false if the list did not behave like its model
+ */
+bool step(fuzz *fz, family f, int k) {
+    dll_t *list = fz->lists[k];
+    model *m = &fz->models[k];
+    int value = rand() % MAX_VALUE;
+    int *data = &fz->values[value];
+    int pos = m->size ? rand() % m->size : 0;
+    int result = -1;
+    void *ref = NULL; // removed data of REFERENCE lists
+    double start = now();
+    switch (f) {
+    case INSERT:
+        if (m->size >= MAX_SIZE) return true;
+        pos = rand() % (m->size + 1);
+        // negative positions count from the end
+        dll_insert(list, rand() % 2 ? pos : pos - m->size - 1, data);
+        add_time(fz, f, start);
+        model_insert(m, pos, value);
+        break;
+    case REMOVE:
+        if (m->size == 0) return true;
+        ref = dll_remove(list, rand() % 2 ? pos : pos - m->size, &result);
+        add_time(fz, f, start);
+        if (removed_value(fz, ref, result) != model_remove(m, pos)) return false;
+        break;
+    case PUSH:
+        if (m->size >= MAX_SIZE) return true;
+        if (rand() % 2) {
+            dll_push_front(list, data);
+            add_time(fz, f, start);
+            model_insert(m, 0, value);
+        } else {
+            dll_push_back(list, data);
+            add_time(fz, f, start);
+            model_insert(m, m->size, value);
+        }
+        break;
+    case POP:
+        if (m->size == 0) return true;
+        if (rand() % 2) {
+            ref = dll_pop_front(list, &result);
+            add_time(fz, f, start);
+            if (removed_value(fz, ref, result) != model_remove(m, 0)) return false;
+        } else {
+            ref = dll_pop_back(list, &result);
+            add_time(fz, f, start);
+            if (removed_value(fz, ref, result) != model_remove(m, m->size - 1)) return false;
+        }
+        break;
+    case PEEK:
+        if (m->size == 0) return true;
+        result = *(int *)dll_peek(list, pos);
+        add_time(fz, f, start);
+        if (result != m->data[pos]) return false;
+        break;
+    case REVERSE:
+        if (rand() % 8) {
+            dll_reverse(list);
+            add_time(fz, f, start);
+            model_reverse(m);
+        } else {
+            dll_materialize(list); // keeps the order
+            add_time(fz, f, start);
+        }
+        break;
+    case SORT:
+        dll_sort(list, int_cmp);
+        add_time(fz, f, start);
+        qsort(m->data, m->size, sizeof(int), int_qsort_cmp);
+        break;
+    case CLEAR:
+        dll_clear(list);
+        add_time(fz, f, start);
+        m->size = 0;
+        break;
+    case ITERATE: {
+        foreach_check fc = {m, true};
+        dll_foreach(list, foreach_compare, &fc);
+        add_time(fz, f, start);
+        if (!fc.ok) return false;
+        break;
+    }
+    case SPLICE: {
+        int other = 1 - k;
+        model *o = &fz->models[other];
+        int from = rand() % (m->size + 1);
+        int to = from + rand() % (m->size - from + 1);
+        int at = rand() % (o->size + 1);
+        if (o->size + to - from > 2 * MAX_SIZE) return true;
+        int how = rand() % 3;
+        if (how == 2 && fz->mode != RING && fz->partner != RING && from < to) {
+            // iterators on the first and last moved element and on at
+            // (a new iterator is on no element: append)
+            dlli_t *first = dll_iter(list);
+            dlli_t *last = dll_iter(list);
+            dlli_t *at_iter = dll_iter(fz->lists[other]);
+            for (int i = 0; i <= from; ++i) dlli_next(first);
+            for (int i = 0; i < to; ++i) dlli_next(last);
+            for (int i = 0; at < o->size && i <= at; ++i) dlli_next(at_iter);
+            int after = at < o->size ? o->data[at] : -1;
+            dlli_splice(at_iter, first, last);
+            add_time(fz, f, start);
+            // last is still on its element, now followed by the one of at
+            int *next = dlli_next(last);
+            bool ok = next ? *next == after : after == -1;
+            dlli_delete(first);
+            dlli_delete(last);
+            dlli_delete(at_iter);
+            if (!ok) return false;
+        } else if (how) {
+            dll_splice(fz->lists[other], at, list, from, to);
+            add_time(fz, f, start);
+        } else {
+            // split off the tail and move it to the other list
+            to = m->size;
+            dll_t *tail = dll_split(list, from);
+            dll_splice(fz->lists[other], at, tail, 0, dll_size(tail));
+            add_time(fz, f, start);
+            bool empty = dll_size(tail) == 0;
+            dll_delete(tail, NULL);
+            if (!empty) return false;
+        }
+        model_splice(o, at, m, from, to);
+        break;
+    }
+    case FIND: {
+        int found = -1;
+        for (int i = 0; i < m->size && found < 0; ++i) {
+            if (m->data[i] == value) found = i;
+        }
+        // REFERENCE lists find the pointer into values
+        bool contains = dll_contains(list, data);
+        int *elem = dll_find(list, data);
+        void *dest = fz->op_mode == REFERENCE ? (void *)&ref : &result;
+        bool removed = rand() % 2 && dll_remove_value(list, data, dest);
+        add_time(fz, f, start);
+        if (contains != (found >= 0) || (found >= 0) != (elem != NULL)) return false;
+        if (elem && !removed && *elem != value) return false;
+        if (removed) {
+            if (removed_value(fz, ref, result) != value) return false;
+            // which equal element is removed is not specified
+            int i = 0;
+            while (i < m->size - 1 && *(int *)dll_peek(list, i) == m->data[i]) ++i;
+            if (m->data[i] != value) return false;
+            model_remove(m, i);
+        }
+        break;
+    }
+    case SNAPSHOT: {
+        // snapshots keep their data while the lists change (see run); a
+        // changed snapshot becomes a list of its own
+        int s = rand() % SNAPSHOTS;
+        int from = rand() % SNAPSHOTS;
+        dll_t *snapshot = fz->snapshots[s];
+        model *sm = &fz->snapshot_models[s];
+        bool ok = true;
+        if (!snapshot && fz->snapshots[from] && rand() % 2) {
+            fz->snapshots[s] = dll_snapshot(fz->snapshots[from]);
+            *sm = fz->snapshot_models[from];
+        } else if (!snapshot) {
+            fz->snapshots[s] = dll_snapshot(list);
+            *sm = *m;
+        } else if (rand() % 4) {
+            dll_delete(snapshot, NULL);
+            fz->snapshots[s] = NULL;
+        } else {
+            if (rand() % 4 && sm->size < MAX_SIZE) {
+                dll_push_front(snapshot, data);
+                model_insert(sm, 0, value);
+            } else {
+                dll_clear(snapshot);
+                sm->size = 0;
+            }
+            ok = check(snapshot, sm);
+            dll_delete(snapshot, NULL);
+            fz->snapshots[s] = NULL;
+        }
+        add_time(fz, f, start);
+        if (!ok) return false;
+        break;
+    }
+    case COMPACT:
+        if (rand() % 2) dll_compact(list);
+        else dll_reserve(list, rand() % 32);
+        add_time(fz, f, start);
+        break;
+    case HEAP: {
+        // move the list into a heap, pop a few elements, drain the rest back
+        dllh_t *heap = dllh_new(fz->op_mode, sizeof(int), int_cmp);
+        dllh_push_list(heap, list);
+        bool ok = dll_size(list) == 0;
+        if (m->size < MAX_SIZE) {
+            dllh_push(heap, data);
+            model_insert(m, m->size, value);
+        }
+        qsort(m->data, m->size, sizeof(int), int_qsort_cmp);
+        ok = ok && dllh_size(heap) == m->size;
+        for (int i = rand() % 4; ok && i > 0 && m->size > 0; --i) {
+            ok = *(int *)dllh_peek(heap) == m->data[0];
+            ref = dllh_pop(heap, &result);
+            ok = ok && removed_value(fz, ref, result) == model_remove(m, 0);
+        }
+        dllh_drain(heap, list);
+        ok = ok && dllh_size(heap) == 0;
+        dllh_delete(heap, NULL);
+        add_time(fz, f, start);
+        if (!ok) return false;
+        break;
+    }
+    case MERGE: {
+        int other = 1 - k;
+        model *o = &fz->models[other];
+        if (m->size + o->size > 2 * MAX_SIZE) return true;
+        dll_t *lists[2] = {list, fz->lists[other]};
+        dll_sort(lists[0], int_cmp);
+        dll_sort(lists[1], int_cmp);
+        start = now();
+        dll_kway_merge(lists, 2, int_cmp);
+        add_time(fz, f, start);
+        memcpy(m->data + m->size, o->data, o->size * sizeof(int));
+        m->size += o->size;
+        o->size = 0;
+        qsort(m->data, m->size, sizeof(int), int_qsort_cmp);
+        break;
+    }
+    default:
+        break;
+    }
+    fz->stats->count[f][fz->mode][fz->op_mode == REFERENCE]++;
+    return true;
+}
+
+/**
+ * @brief picks the next operation family; expensive ones are rare
+ */
+family random_family(void) {
+    int r = rand() % 100;
+    if (r < 20) return INSERT;
+    if (r < 32) return REMOVE;
+    if (r < 44) return PUSH;
+    if (r < 54) return POP;
+    if (r < 70) return PEEK;
+    if (r < 75) return REVERSE;
+    if (r < 77) return SORT;
+    if (r < 78) return CLEAR;
+    if (r < 83) return ITERATE;
+    if (r < 88) return SPLICE;
+    if (r < 93) return FIND;
+    if (r < 94) return HEAP;
+    if (r < 95) return MERGE;
+    if (r < 97) return SNAPSHOT;
+    return COMPACT;
+}
+
+/**
+ * @brief runs ops random operations on a list of storage mode and one of
+ * storage partner (splice and merge move elements between them)
+ *
+ * @return true if all lists behaved like their models
+ */
+bool run(storage mode, storage partner, op_mode op, long ops, unsigned seed, stats *stats) {
+    fuzz *fz = calloc(1, sizeof(*fz));
+    if (!fz) return false;
+    fz->mode = mode;
+    fz->partner = partner;
+    fz->op_mode = op;
+    fz->stats = stats;
+    for (int i = 0; i < MAX_VALUE; ++i) fz->values[i] = i;
+    fz->lists[0] = new_list(mode, op);
+    fz->lists[1] = new_list(partner, op);
+    srand(seed);
+    bool ok = true;
+    for (fz->op = 0; ok && fz->op < ops; ++fz->op) {
+        int k = rand() % 2;
+        family f = random_family();
+        ok = step(fz, f, k);
+        ok = ok && check(fz->lists[0], &fz->models[0]) && check(fz->lists[1], &fz->models[1]);
+        for (int s = 0; ok && s < SNAPSHOTS; ++s) {
+            ok = !fz->snapshots[s] || check(fz->snapshots[s], &fz->snapshot_models[s]);
+        }
+        if (!ok) {
+            printf("FAILED: seed %u, modes %s/%s, %s, operation %ld (%s on list %d)\n",
+                seed, storage_name(mode), storage_name(partner),
+                op == VALUE ? "value" : "reference", fz->op, family_name(f), k);
+        }
+    }
+    // the lists go first: their snapshots free the nodes
+    dll_delete(fz->lists[0], NULL);
+    dll_delete(fz->lists[1], NULL);
+    for (int s = 0; s < SNAPSHOTS; ++s) dll_delete(fz->snapshots[s], NULL);
+    free(fz);
+    return ok;
+}
+
+/**
+ * @brief runs ops random operations on a queue and checks them against a
+ * model (single thread: only calls that cannot block); closes and
+ * replaces the queue now and then
+ *
+ * @return true if the queue behaved like its model
+ */
+bool run_queue(op_mode op, long ops, unsigned seed) {
+    int values[MAX_VALUE]; // REFERENCE queues store pointers into values
+    for (int i = 0; i < MAX_VALUE; ++i) values[i] = i;
+    model *m = calloc(1, sizeof(*m));
+    if (!m) return false;
+    srand(seed);
+    int capacity = 1 + rand() % MAX_CAPACITY;
+    dllq_t *queue = dllq_new(op, sizeof(int), capacity);
+    bool closed = false;
+    int out[MAX_CAPACITY + 1];
+    void *refs[MAX_CAPACITY + 1];
+    void *dest = op == REFERENCE ? (void *)refs : out;
+    // 0 would read as "closed and empty" (prints an error)
+    bool ok = queue && dllq_pop_batch(queue, dest, 0) == -1;
+    for (long i = 0; ok && i < ops; ++i) {
+        int value = rand() % MAX_VALUE;
+        int *data = &values[value];
+        int r = rand() % 100;
+        bool can_push = !closed && m->size < capacity;
+        bool pushed = false;
+        int popped = 0; // number of elements in dest
+        if (r < 15) {
+            pushed = dllq_try_push(queue, data);
+            ok = pushed == can_push;
+        } else if (r < 25) {
+            pushed = dllq_timed_push(queue, data, 0);
+            ok = pushed == can_push;
+        } else if (r < 35) {
+            // would block if full and open
+            if (can_push || closed) pushed = dllq_push(queue, data);
+            ok = pushed == can_push;
+        } else if (r < 50) {
+            popped = dllq_try_pop(queue, dest);
+            ok = popped == (m->size > 0);
+        } else if (r < 60) {
+            popped = dllq_timed_pop(queue, dest, 0);
+            ok = popped == (m->size > 0);
+        } else if (r < 70) {
+            // would block if empty and open
+            if (m->size > 0 || closed) popped = dllq_pop(queue, dest);
+            ok = popped == (m->size > 0);
+        } else if (r < 85) {
+            int max = 1 + rand() % (capacity + 1);
+            if (m->size > 0 || closed) {
+                popped = dllq_pop_batch(queue, dest, max);
+                ok = popped == (m->size < max ? m->size : max);
+            }
+        } else if (r < 99) {
+            ok = dllq_size(queue) == m->size;
+        } else {
+            dllq_close(queue);
+            closed = true;
+        }
+        if (ok && pushed) model_insert(m, m->size, value);
+        for (int j = 0; ok && j < popped; ++j) {
+            int got = op == REFERENCE ? *(int *)refs[j] : out[j];
+            ok = got == model_remove(m, 0);
+        }
+        if (ok && closed && m->size == 0) {
+            // closed and empty: every pop fails at once
+            ok = !dllq_pop(queue, dest) && dllq_pop_batch(queue, dest, 1) == 0;
+            dllq_delete(queue, NULL);
+            capacity = 1 + rand() % MAX_CAPACITY;
+            queue = dllq_new(op, sizeof(int), capacity);
+            closed = false;
+            ok = ok && queue != NULL;
+        }
+        if (!ok) {
+            printf("FAILED: seed %u, queue, %s, operation %ld\n",
+                seed, op == VALUE ? "value" : "reference", i);
+        }
+    }
+    dllq_delete(queue, NULL);
+    free(m);
+    return ok;
+}
+
+/**
+ * @brief state of the threaded queue test; item i of producer p is
+ * p * items + i
+ */
+typedef struct queue_test {
+    dllq_t *queue;
+    op_mode op_mode;
+    int items; // per producer
+    int *values; // REFERENCE queues store pointers into values
+    int producer; // index of the next producer thread
+    int consumer; // index of the next consumer thread
+    long popped[CONSUMERS]; // per consumer
+    bool ok[CONSUMERS]; // false: a consumer saw items of a producer out of order
+    pthread_mutex_t lock; // protects producer and consumer
+} queue_test;
+
+/**
+ * @brief pushes the items of one producer in order, with every push call
+ */
+void *producer(void *usr) {
+    queue_test *qt = usr;
+    pthread_mutex_lock(&qt->lock);
+    int p = qt->producer++;
+    pthread_mutex_unlock(&qt->lock);
+    for (int i = 0; i < qt->items; ++i) {
+        int *data = &qt->values[p * qt->items + i];
+        switch (i % 3) {
+        case 0:
+            dllq_push(qt->queue, data);
+            break;
+        case 1:
+            while (!dllq_timed_push(qt->queue, data, 1));
+            break;
+        default:
+            while (!dllq_try_push(qt->queue, data));
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief pops until the queue is closed and empty; checks that the items
+ * of every producer come in order
+ */
+void *consumer(void *usr) {
+    queue_test *qt = usr;
+    pthread_mutex_lock(&qt->lock);
+    int c = qt->consumer++;
+    pthread_mutex_unlock(&qt->lock);
+    int last[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; ++p) last[p] = -1;
+    int out[MAX_CAPACITY];
+    void *refs[MAX_CAPACITY];
+    void *dest = qt->op_mode == REFERENCE ? (void *)refs : out;
+    bool ok = true;
+    for (int round = 0;; ++round) {
+        int count = round % 2 ? dllq_pop_batch(qt->queue, dest, MAX_CAPACITY)
+            : dllq_pop(qt->queue, dest);
+        if (count <= 0) break; // closed and empty
+        for (int j = 0; j < count; ++j) {
+            int item = qt->op_mode == REFERENCE ? *(int *)refs[j] : out[j];
+            int p = item / qt->items;
+            ok = ok && p < PRODUCERS && item % qt->items > last[p];
+            if (p < PRODUCERS) last[p] = item % qt->items;
+        }
+        qt->popped[c] += count;
+    }
+    qt->ok[c] = ok;
+    return NULL;
+}
+
+/**
+ * @brief runs PRODUCERS and CONSUMERS threads on a small queue; checks
+ * that every item arrives once and in order per producer
+ *
+ * @return true if the queue lost, duplicated or reordered no items
+ */
+bool run_queue_threads(op_mode op, int items) {
+    queue_test qt = {0};
+    qt.op_mode = op;
+    qt.items = items;
+    qt.values = malloc(PRODUCERS * items * sizeof(int));
+    qt.queue = dllq_new(op, sizeof(int), 1 + rand() % MAX_CAPACITY);
+    if (!qt.values || !qt.queue || pthread_mutex_init(&qt.lock, NULL) != 0) {
+        free(qt.values);
+        dllq_delete(qt.queue, NULL);
+        return false;
+    }
+    for (int i = 0; i < PRODUCERS * items; ++i) qt.values[i] = i;
+    pthread_t producers[PRODUCERS], consumers[CONSUMERS];
+    for (int c = 0; c < CONSUMERS; ++c) pthread_create(&consumers[c], NULL, consumer, &qt);
+    for (int p = 0; p < PRODUCERS; ++p) pthread_create(&producers[p], NULL, producer, &qt);
+    for (int p = 0; p < PRODUCERS; ++p) pthread_join(producers[p], NULL);
+    dllq_close(qt.queue);
+    long popped = 0;
+    bool ok = true;
+    // the index of a thread is not its place in consumers: join all first
+    for (int c = 0; c < CONSUMERS; ++c) pthread_join(consumers[c], NULL);
+    for (int c = 0; c < CONSUMERS; ++c) {
+        popped += qt.popped[c];
+        ok = ok && qt.ok[c];
+    }
+    ok = ok && popped == (long)PRODUCERS * items && dllq_size(qt.queue) == 0;
+    if (!ok) {
+        printf("FAILED: threaded queue, %s, %ld of %d items\n",
+            op == VALUE ? "value" : "reference", popped, PRODUCERS * items);
+    }
+    pthread_mutex_destroy(&qt.lock);
+    dllq_delete(qt.queue, NULL);
+    free(qt.values);
+    return ok;
+}
+
+/**
+ * @brief snapshot handed from the writer to a reader: holds the values
+ * first, first + 1, ... (descending: first + size - 1, ..., first)
+ */
+typedef struct snapshot_item {
+    dll_t *snapshot;
+    int first;
+    int size;
+    bool descending;
+} snapshot_item;
+
+/**
+ * @brief state of the threaded snapshot test
+ */
+typedef struct snapshot_test {
+    dllq_t *queue; // of snapshot_item
+    int reader; // index of the next reader thread
+    long checked[READERS]; // per reader
+    bool ok[READERS]; // false: a reader saw a wrong snapshot
+    pthread_mutex_t lock; // protects reader
+} snapshot_test;
+
+/**
+ * @brief checks a snapshot against the values it has to hold; uses only
+ * functions a reader may call while the writer changes the list
+ * (dll_validate reads links the writer changes)
+ */
+bool check_snapshot(dll_t *list, snapshot_item *item) {
+    if (dll_size(list) != item->size) return false;
+    int step = item->descending ? -1 : 1;
+    int value = item->descending ? item->first + item->size - 1 : item->first;
+    bool ok = true;
+    int i = 0;
+    dlli_t *iter = dll_iter(list);
+    while (ok && dlli_has_next(iter)) {
+        ok = *(int *)dlli_next(iter) == value + i++ * step;
+    }
+    dlli_delete(iter);
+    if (!ok || i != item->size) return false;
+    iter = dll_iter(list);
+    while (ok && dlli_has_prev(iter)) {
+        ok = *(int *)dlli_prev(iter) == value + --i * step;
+    }
+    dlli_delete(iter);
+    if (!ok || i != 0) return false;
+    return item->size == 0 || *(int *)dll_peek(list, item->size / 2) == value + item->size / 2 * step;
+}
+
+/**
+ * @brief checks the snapshots of the writer until the queue is closed and
+ * empty; takes a snapshot of every snapshot and checks it, too
+ */
+void *reader(void *usr) {
+    snapshot_test *st = usr;
+    pthread_mutex_lock(&st->lock);
+    int r = st->reader++;
+    pthread_mutex_unlock(&st->lock);
+    bool ok = true;
+    snapshot_item item;
+    while (dllq_pop(st->queue, &item)) {
+        ok = ok && check_snapshot(item.snapshot, &item);
+        dll_t *snapshot = dll_snapshot(item.snapshot);
+        dll_delete(item.snapshot, NULL);
+        ok = ok && check_snapshot(snapshot, &item);
+        dll_delete(snapshot, NULL);
+        st->checked[r]++;
+    }
+    st->ok[r] = ok;
+    return NULL;
+}
+
+/**
+ * @brief one writer changes a list of storage mode (a queue of ascending
+ * values, now and then reversed, sorted or compacted) and hands snapshots
+ * to READERS threads, which check them while the writer goes on
+ *
+ * @return true if every snapshot held the values of its epoch
+ */
+bool run_snapshot_threads(storage mode, op_mode op, int ops, unsigned seed) {
+    snapshot_test st = {0};
+    int *values = malloc((ops + 1) * sizeof(int)); // REFERENCE lists point here
+    dll_t *list = new_list(mode, op);
+    st.queue = dllq_new(VALUE, sizeof(snapshot_item), 2 * READERS);
+    if (!values || !list || !st.queue || pthread_mutex_init(&st.lock, NULL) != 0) {
+        free(values);
+        dll_delete(list, NULL);
+        dllq_delete(st.queue, NULL);
+        return false;
+    }
+    for (int i = 0; i <= ops; ++i) values[i] = i;
+    pthread_t readers[READERS];
+    for (int r = 0; r < READERS; ++r) pthread_create(&readers[r], NULL, reader, &st);
+    srand(seed);
+    int first = 0; // the list holds first, ..., next - 1
+    int next = 0;
+    bool descending = false;
+    bool ok = true;
+    for (int i = 0; ok && i < ops; ++i) {
+        int r = rand() % 100;
+        int result = -1;
+        void *ref = NULL;
+        if (r < 50 || next - first < 8) {
+            if (descending) dll_push_front(list, &values[next++]);
+            else dll_push_back(list, &values[next++]);
+        } else if (r < 90) {
+            ref = descending ? dll_pop_back(list, &result) : dll_pop_front(list, &result);
+            ok = (op == REFERENCE ? *(int *)ref : result) == first++;
+        } else if (r < 93) {
+            dll_reverse(list);
+            descending = !descending;
+        } else if (r < 95) {
+            dll_sort(list, int_cmp); // copies the shared nodes
+            descending = false;
+        } else if (r < 96) {
+            dll_compact(list);
+        } else {
+            snapshot_item item = {dll_snapshot(list), first, next - first, descending};
+            // the writer deletes a snapshot no reader takes
+            if (!dllq_try_push(st.queue, &item)) dll_delete(item.snapshot, NULL);
+        }
+        ok = ok && dll_size(list) == next - first;
+    }
+    dll_delete(list, NULL); // the readers may still use snapshots
+    dllq_close(st.queue);
+    long checked = 0;
+    for (int r = 0; r < READERS; ++r) pthread_join(readers[r], NULL);
+    for (int r = 0; r < READERS; ++r) {
+        checked += st.checked[r];
+        ok = ok && st.ok[r];
+    }
+    if (!ok) {
+        printf("FAILED: seed %u, snapshot threads, mode %s, %s (%ld snapshots checked)\n",
+            seed, storage_name(mode), op == VALUE ? "value" : "reference", checked);
+    }
+    pthread_mutex_destroy(&st.lock);
+    dllq_delete(st.queue, NULL);
+    free(values);
+    return ok;
+}
+
+/**
+ * @brief prints ns per operation for every family and storage mode (of
+ * the first list), one table per op_mode
+ */
+void print_stats(stats *stats) {
+    for (int op = 0; op < 2; ++op) {
+        printf("%-14s", op ? "ns/op (ref)" : "ns/op (value)");
+        for (int s = 0; s < STORAGES; ++s) printf("%12s", storage_name(s));
+        printf("\n");
+        for (int f = 0; f < FAMILIES; ++f) {
+            printf("%-14s", family_name(f));
+            for (int s = 0; s < STORAGES; ++s) {
+                long count = stats->count[f][s][op];
+                if (count) printf("%12.0f", stats->seconds[f][s][op] * 1e9 / count);
+                else printf("%12s", "-");
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    unsigned seed = argc > 1 ? (unsigned)atol(argv[1]) : (unsigned)time(NULL);
+    long ops = argc > 2 ? atol(argv[2]) : 20000;
+    stats *stats = calloc(1, sizeof(*stats));
+    if (!stats) return 1;
+    bool ok = true;
+    op_mode op_modes[2] = {VALUE, REFERENCE};
+    for (int op = 0; op < 2; ++op) {
+        for (int mode = 0; ok && mode < STORAGES; ++mode) {
+            // two lists of mode, then mode with another storage:
+            // linked/ring, reserved/linked, indexed/reserved, ring/indexed
+            ok = run(mode, mode, op_modes[op], ops, seed, stats)
+                && run(mode, (mode + STORAGES - 1) % STORAGES, op_modes[op], ops, seed, stats);
+        }
+        ok = ok && run_queue(op_modes[op], ops, seed)
+            && run_queue_threads(op_modes[op], ops);
+        for (int mode = 0; ok && mode < STORAGES; ++mode) {
+            ok = run_snapshot_threads(mode, op_modes[op], ops, seed);
+        }
+    }
+    print_stats(stats);
+    printf("%s (seed %u, %ld operations per run)\n", ok ? "ok" : "FAILED", seed, ops);
+    free(stats);
+    return ok ? 0 : 1;
+}
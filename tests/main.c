@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "dll.h"
+#include "dllq.h"
 
 typedef struct tmp {
     int i;
@@ -34,6 +35,14 @@ int a_cmp(void *dl, void *dr) {
     return 1;
 }
 
+size_t a_hash(void *v) {
+    return (size_t)*(int *)v;
+}
+
+bool a_equal(void *dl, void *dr) {
+    return *(int *)dl == *(int *)dr;
+}
+
 int main(int argc, char const *argv[]) {
 
     int arr[5] = {4,2,5,3,1};
@@ -63,8 +72,84 @@ int main(int argc, char const *argv[]) {
     dll_sort(list_a, a_cmp);
     dll_display(list_a, a_display);
 
+    dll_t *list_b = dll_split(list_a, 2);
+    dll_display(list_a, a_display);
+    dll_display(list_b, a_display);
+    dll_splice(list_a, 1, list_b, 0, 2);
+    dll_display(list_a, a_display);
+    dll_display(list_b, a_display);
+    // move the first element back with iterators
+    dlli_t *first = dll_iter(list_a);
+    dlli_t *at = dll_iter(list_b);
+    dlli_next(first);
+    dlli_splice(at, first, first);
+    dll_display(list_b, a_display);
+    dlli_delete(first);
+    dlli_delete(at);
+    printf("%d %d\n", dll_size(list_a), dll_size(list_b));
+
+    int s = 0;
+    for (int i = 0; i < dll_size(list_a); ++i) {
+        s += *(int *)dll_peek(list_a, i);
+    }
+    printf("sum: %d last: %d\n", s, *(int *)dll_peek(list_a, -1));
+
+    dll_memory_usage_t usage = dll_memory_usage(list_a);
+    printf("memory: %zu (payload %zu, links %zu, overhead %zu)\n",
+        usage.total, usage.payload, usage.links, usage.overhead);
+    dll_compact(list_a);
+    usage = dll_memory_usage(list_a);
+    printf("compacted: %zu\n", usage.total);
+    dll_display(list_a, a_display);
+
+    dll_reverse(list_a);
+    dll_display(list_a, a_display);
+
+    dll_t *snapshot = dll_snapshot(list_a);
+    dll_pop_front(list_a, NULL);
+    dll_display(list_a, a_display);
+    dll_display(snapshot, a_display);
+    dll_delete(snapshot, NULL);
+
+    dll_delete(list_b, NULL);
     dll_delete(list_a, NULL);
 
+    dll_t *set = dll_new_indexed(VALUE, sizeof(int), a_hash, a_equal);
+    for (int i = 0; i < 5; ++i) dll_push_back(set, &arr[i]);
+    int key = 5;
+    printf("contains 5: %d\n", dll_contains(set, &key));
+    dll_remove_value(set, &key, NULL);
+    printf("contains 5: %d\n", dll_contains(set, &key));
+    dll_display(set, a_display);
+    dll_delete(set, NULL);
+
+    dll_t *ring = dll_new_ring(VALUE, sizeof(int));
+    for (int i = 0; i < 5; ++i) dll_push_front(ring, &arr[i]);
+    dll_insert(ring, 2, &key);
+    dll_sort(ring, a_cmp);
+    printf("ring middle: %d\n", *(int *)dll_peek(ring, 3));
+    dll_display(ring, a_display);
+    dll_delete(ring, NULL);
+
+    dllh_t *heap = dllh_new(VALUE, sizeof(int), a_cmp);
+    for (int i = 0; i < 5; ++i) dllh_push(heap, &arr[i]);
+    printf("heap first: %d\n", *(int *)dllh_peek(heap));
+    dll_t *sorted[2] = {dll_new(VALUE, sizeof(int)), dll_new(VALUE, sizeof(int))};
+    dllh_drain(heap, sorted[0]);
+    for (int i = 0; i < 5; ++i) dll_push_back(sorted[1], &i);
+    dll_kway_merge(sorted, 2, a_cmp);
+    dll_display(sorted[0], a_display);
+    dll_delete(sorted[0], NULL);
+    dll_delete(sorted[1], NULL);
+    dllh_delete(heap, NULL);
+
+    dllq_t *queue = dllq_new(VALUE, sizeof(int), 4);
+    for (int i = 0; dllq_try_push(queue, &i); ++i);
+    int batch[4];
+    int count = dllq_pop_batch(queue, batch, 4);
+    printf("queue: %d items, last %d\n", count, batch[count - 1]);
+    dllq_delete(queue, NULL);
+
     /*
     dll_t *list = dll_new(VALUE, sizeof(tmp));
     //dll_t *list = dll_new(REFERENCE, 0);